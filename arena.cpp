@@ -0,0 +1,173 @@
+#include "arena.h"
+
+namespace cop4530 {
+
+    // ***********************************************************************
+    // * Function Name: Arena                                                *
+    // * Description: Constructor, creates an arena that holds no chunk yet  *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t firstChunk: Size of the first chunk; later ones double     *
+    // * - std::pmr::memory_resource* upstream: Where chunks come from       *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+Arena::Arena(size_t firstChunk, std::pmr::memory_resource* upstream)
+    : upstream(upstream), freeLists(), cursor(nullptr), limit(nullptr),
+      firstChunk(firstChunk < max_block ? max_block : firstChunk), nextChunk(this->firstChunk),
+      reservedBytes(0) {}
+
+    // ***********************************************************************
+    // * Function Name: ~Arena                                               *
+    // * Description: Destructor, returns every chunk upstream               *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+Arena::~Arena() {
+    release();
+}
+
+    // ***********************************************************************
+    // * Function Name: release                                              *
+    // * Description: Returns every chunk upstream and starts over from the  *
+    // *              first chunk size                                       *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void Arena::release() {
+    for (const auto& chunk : chunks) {
+        upstream->deallocate(chunk.first, chunk.second, granule);
+    }
+    chunks.clear();
+    for (auto& head : freeLists) {
+        head = nullptr;
+    }
+    cursor = limit = nullptr;
+    nextChunk = firstChunk;
+    reservedBytes = 0;
+}
+
+    // ***********************************************************************
+    // * Function Name: reserved                                             *
+    // * Description: Returns the bytes the arena holds in chunks            *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+size_t Arena::reserved() const {
+    return reservedBytes;
+}
+
+    // ***********************************************************************
+    // * Function Name: do_allocate                                          *
+    // * Description: Rounds the request up to a size class and pops a block *
+    // *              off its free list, or bumps the cursor of the current  *
+    // *              chunk when the list is empty                           *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t bytes: The size of the block                               *
+    // * - size_t alignment: The alignment the block needs                   *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void* Arena::do_allocate(size_t bytes, size_t alignment) {
+    if (bytes > max_block || alignment > granule) {
+        return upstream->allocate(bytes, alignment);
+    }
+    size_t rounded = bytes == 0 ? granule : (bytes + granule - 1) / granule * granule;
+    FreeBlock*& head = freeLists[rounded / granule - 1];
+    if (head) {
+        FreeBlock* block = head;
+        head = block->next;
+        return block;
+    }
+    if (static_cast<size_t>(limit - cursor) < rounded) {
+        grow(rounded);
+    }
+    void* block = cursor;
+    cursor += rounded;
+    return block;
+}
+
+    // ***********************************************************************
+    // * Function Name: do_deallocate                                        *
+    // * Description: Pushes a block onto the free list of its size class,   *
+    // *              or hands an upstream block back                        *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - void* p: The block                                                *
+    // * - size_t bytes: The size it was allocated with                      *
+    // * - size_t alignment: The alignment it was allocated with             *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void Arena::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    if (bytes > max_block || alignment > granule) {
+        upstream->deallocate(p, bytes, alignment);
+        return;
+    }
+    size_t rounded = bytes == 0 ? granule : (bytes + granule - 1) / granule * granule;
+    FreeBlock*& head = freeLists[rounded / granule - 1];
+    FreeBlock* block = static_cast<FreeBlock*>(p);
+    block->next = head;
+    head = block;
+}
+
+    // ***********************************************************************
+    // * Function Name: do_is_equal                                          *
+    // * Description: An arena only equals itself, since a block must go     *
+    // *              back to the arena it came from                         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::pmr::memory_resource& other: The resource              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool Arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+    // ***********************************************************************
+    // * Function Name: grow                                                 *
+    // * Description: Starts a new chunk, twice the size of the last one up  *
+    // *              to max_chunk. What is left of the old chunk is given   *
+    // *              to the free lists rather than thrown away              *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t bytes: The block that did not fit in the current chunk     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void Arena::grow(size_t bytes) {
+    size_t left = static_cast<size_t>(limit - cursor);
+    if (left >= granule) {
+        // left is below the block that did not fit, so it is a valid size class
+        do_deallocate(cursor, left / granule * granule, granule);
+    }
+    size_t size = nextChunk < bytes ? bytes : nextChunk;
+    cursor = static_cast<char*>(upstream->allocate(size, granule));
+    limit = cursor + size;
+    chunks.emplace_back(cursor, size);
+    reservedBytes += size;
+    if (nextChunk < max_chunk) {
+        nextChunk *= 2;
+    }
+}
+
+}
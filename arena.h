@@ -0,0 +1,67 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
+namespace cop4530 {
+
+// Memory resource for the many small, same-sized blocks a hash table makes,
+// list nodes above all. Blocks are carved from chunks that double in size
+// up to max_chunk, so a bulk load costs a few dozen allocations however many
+// entries it adds. A freed block goes on the free list of its size class and
+// is handed out again by the next allocation of that class, so a table that
+// keeps removing and inserting does not grow. Chunks go back upstream only
+// in release() and the destructor, which is what makes teardown cheap.
+//
+// Blocks larger than max_block, or aligned beyond max_align_t, come straight
+// from the upstream resource. An Arena is not thread-safe; like the table it
+// serves, callers must serialize access.
+class Arena : public std::pmr::memory_resource {
+public:
+    explicit Arena(size_t firstChunk = 64 * 1024,
+                   std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Returns every chunk upstream. Only valid once nothing allocated from
+    // the arena is still in use.
+    void release();
+    size_t reserved() const; // bytes held in chunks
+
+private:
+    static const size_t granule = alignof(std::max_align_t);
+    static const size_t max_block = 512;
+    static const size_t max_chunk = 16 << 20;
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+    std::pmr::memory_resource* upstream;
+    std::vector<std::pair<void*, size_t>> chunks;
+    FreeBlock* freeLists[max_block / granule];
+    char* cursor;
+    char* limit;
+    size_t firstChunk;
+    size_t nextChunk;
+    size_t reservedBytes;
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+    void grow(size_t bytes);
+};
+
+// Allocator that places a table's nodes in an Arena:
+//   Arena arena;
+//   HashTable<std::string, std::string, separate_chaining,
+//             ArenaAllocator<std::pair<std::string, std::string>>> table(101, &arena);
+// A copy of such a table allocates from the default resource, as
+// polymorphic_allocator copies do, so it can safely be used on another thread.
+template <typename T>
+using ArenaAllocator = std::pmr::polymorphic_allocator<T>;
+
+}
+
+#endif
@@ -1,6 +1,11 @@
 #include <stdlib.h>
 #include "base64.h"
 
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BASE64_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
 // *********************************************************************
 // ****************************** MACROS *******************************
 // *********************************************************************
@@ -34,9 +39,223 @@ BYTE revchar(char ch)
   return(ch);
 }
 
+// **********************************************************************
+// * revtable[c] == revchar(c) for every byte, so the decoder does one   *
+// * load per character instead of the compare chain. Characters        *
+// * outside the alphabet map to themselves, exactly as in revchar().    *
+// **********************************************************************
+
+struct RevTable {
+  BYTE value[256];
+  RevTable() {
+    for (int c = 0; c < 256; c++)
+      value[c] = revchar(static_cast<char>(c));
+  }
+  BYTE operator[](BYTE ch) const { return value[static_cast<unsigned char>(ch)]; }
+};
+
+static const RevTable revtable;
+
+// **********************************************************************
+// ************************* VECTOR KERNELS *****************************
+// * Each kernel converts as many whole blocks as it can at the start of *
+// * the input and returns how many input bytes it consumed; the scalar  *
+// * loops below finish the rest, so every kernel only has to agree with *
+// * them on the blocks it handles. The decoders stop at the first       *
+// * vector holding anything outside the 64 character alphabet ('=',    *
+// * newlines, NULs, ...) and leave it to the scalar loop, which keeps   *
+// * the historical handling of such input.                              *
+// **********************************************************************
+
+typedef size_t (*block_kernel)(const unsigned char* in, size_t len, BYTE* out);
+
+static size_t scalar_blocks(const unsigned char*, size_t, BYTE*)
+{
+  return 0;
+}
+
+#ifdef BASE64_X86_KERNELS
+
+// 12 input bytes in the low lanes of in -> 16 base64 characters.
+// Reference: W. Mula, D. Lemire, "Faster Base64 Encoding and Decoding
+// Using AVX2 Instructions", ACM TOW 2018.
+__attribute__((target("ssse3")))
+static inline __m128i encode_ssse3(__m128i in)
+{
+  in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+  const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+  const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+  const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+  const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+  const __m128i indices = _mm_or_si128(t1, t3);
+
+  __m128i offsets = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+  const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+  offsets = _mm_or_si128(offsets, _mm_and_si128(less, _mm_set1_epi8(13)));
+  const __m128i shift = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                      '/' - 63, 'A', 0, 0);
+  return _mm_add_epi8(_mm_shuffle_epi8(shift, offsets), indices);
+}
+
+__attribute__((target("ssse3")))
+static size_t encode_blocks_ssse3(const unsigned char* in, size_t len, BYTE* out)
+{
+  size_t idx = 0, idx2 = 0;
+  // each step reads 16 bytes but consumes 12
+  for (; idx + 16 <= len; idx += 12, idx2 += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + idx));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + idx2), encode_ssse3(block));
+  }
+  return idx;
+}
+
+__attribute__((target("avx2")))
+static size_t encode_blocks_avx2(const unsigned char* in, size_t len, BYTE* out)
+{
+  const __m256i shuffle = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                           1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  const __m256i shift = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                         '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                         '/' - 63, 'A', 0, 0,
+                                         'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                         '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                         '/' - 63, 'A', 0, 0);
+  size_t idx = 0, idx2 = 0;
+  // 24 bytes per step, 12 in each 128-bit lane; the upper load reads to idx + 28
+  for (; idx + 28 <= len; idx += 24, idx2 += 32) {
+    __m256i in256 = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + idx))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + idx + 12)), 1);
+    in256 = _mm256_shuffle_epi8(in256, shuffle);
+    const __m256i t0 = _mm256_and_si256(in256, _mm256_set1_epi32(0x0fc0fc00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(in256, _mm256_set1_epi32(0x003f03f0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    const __m256i indices = _mm256_or_si256(t1, t3);
+
+    __m256i offsets = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    offsets = _mm256_or_si256(offsets, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+    const __m256i result = _mm256_add_epi8(_mm256_shuffle_epi8(shift, offsets), indices);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + idx2), result);
+  }
+  return idx + encode_blocks_ssse3(in + idx, len - idx, out + idx2);
+}
+
+// 16 base64 characters -> 12 bytes in the low lanes of *decoded.
+// Returns false when any character is outside the alphabet.
+__attribute__((target("ssse3")))
+static inline bool decode_ssse3(__m128i in, __m128i* decoded)
+{
+  const __m128i hi = _mm_and_si128(_mm_srli_epi32(in, 4), _mm_set1_epi8(0x0f));
+  const __m128i lo = _mm_and_si128(in, _mm_set1_epi8(0x0f));
+  const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                       0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                       0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m128i invalid = _mm_and_si128(_mm_shuffle_epi8(lut_lo, lo), _mm_shuffle_epi8(lut_hi, hi));
+  if (_mm_movemask_epi8(_mm_cmpeq_epi8(invalid, _mm_setzero_si128())) != 0xFFFF)
+    return false;
+
+  const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i eq_2F = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+  const __m128i values = _mm_add_epi8(in, _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2F, hi)));
+
+  const __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+  const __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+  *decoded = _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+  return true;
+}
+
+__attribute__((target("ssse3")))
+static size_t decode_blocks_ssse3(const unsigned char* in, size_t len, BYTE* out)
+{
+  size_t idx = 0, idx2 = 0;
+  // each step stores 16 bytes but produces 12; stay inside len / 4 * 3
+  for (; idx2 + 16 <= len && idx + 16 <= len / 4 * 3; idx2 += 16, idx += 12) {
+    __m128i decoded;
+    if (!decode_ssse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + idx2)), &decoded))
+      break;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + idx), decoded);
+  }
+  return idx2;
+}
+
+__attribute__((target("avx2")))
+static size_t decode_blocks_avx2(const unsigned char* in, size_t len, BYTE* out)
+{
+  const __m256i lut_lo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                          0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                          0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                          0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m256i lut_hi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                          0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                          0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                          0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                            0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  size_t idx = 0, idx2 = 0;
+  // each step stores 32 bytes but produces 24; stay inside len / 4 * 3
+  for (; idx2 + 32 <= len && idx + 32 <= len / 4 * 3; idx2 += 32, idx += 24) {
+    const __m256i in256 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + idx2));
+    const __m256i hi = _mm256_and_si256(_mm256_srli_epi32(in256, 4), _mm256_set1_epi8(0x0f));
+    const __m256i lo = _mm256_and_si256(in256, _mm256_set1_epi8(0x0f));
+    const __m256i invalid = _mm256_and_si256(_mm256_shuffle_epi8(lut_lo, lo), _mm256_shuffle_epi8(lut_hi, hi));
+    if (!_mm256_testz_si256(invalid, invalid))
+      break;
+    const __m256i eq_2F = _mm256_cmpeq_epi8(in256, _mm256_set1_epi8('/'));
+    const __m256i values = _mm256_add_epi8(in256, _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2F, hi)));
+    const __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    __m256i packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+    packed = _mm256_shuffle_epi8(packed, pack);
+    packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + idx), packed);
+  }
+  return idx2 + decode_blocks_ssse3(in + idx2, len - idx2, out + idx);
+}
+
+#endif
+
+// **********************************************************************
+// * Picks the widest kernels the CPU supports, once, on first use.      *
+// **********************************************************************
+
+struct Kernels {
+  block_kernel encode;
+  block_kernel decode;
+};
+
+static Kernels select_kernels()
+{
+  Kernels k = { scalar_blocks, scalar_blocks };
+#ifdef BASE64_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    k.encode = encode_blocks_avx2;
+    k.decode = decode_blocks_avx2;
+  }
+  else if (__builtin_cpu_supports("ssse3")) {
+    k.encode = encode_blocks_ssse3;
+    k.decode = decode_blocks_ssse3;
+  }
+#endif
+  return k;
+}
+
+static const Kernels& kernels()
+{
+  static const Kernels selected = select_kernels();
+  return selected;
+}
+
 size_t base64_encode(const BYTE in[], BYTE out[], size_t len, int newline_flag)
 {
   size_t idx, idx2, blks, blk_ceiling, left_over, newline_count = 0;
+  // bytes are used as table indexes, so read them unsigned
+  const unsigned char* uin = reinterpret_cast<const unsigned char*>(in);
 
   blks = (len / 3);
   left_over = len % 3;
@@ -52,11 +271,14 @@ size_t base64_encode(const BYTE in[], BYTE out[], size_t len, int newline_flag)
     // Since 3 input bytes = 4 output bytes, determine out how many even sets of
     // 3 bytes the input has.
     blk_ceiling = blks * 3;
-    for (idx = 0, idx2 = 0; idx < blk_ceiling; idx += 3, idx2 += 4) {
-      out[idx2]     = charset[in[idx] >> 2];
-      out[idx2 + 1] = charset[((in[idx] & 0x03) << 4) | (in[idx + 1] >> 4)];
-      out[idx2 + 2] = charset[((in[idx + 1] & 0x0f) << 2) | (in[idx + 2] >> 6)];
-      out[idx2 + 3] = charset[in[idx + 2] & 0x3F];
+    idx = 0;
+    if (!newline_flag)
+      idx = kernels().encode(uin, len, out);
+    for (idx2 = idx / 3 * 4; idx < blk_ceiling; idx += 3, idx2 += 4) {
+      out[idx2]     = charset[uin[idx] >> 2];
+      out[idx2 + 1] = charset[((uin[idx] & 0x03) << 4) | (uin[idx + 1] >> 4)];
+      out[idx2 + 2] = charset[((uin[idx + 1] & 0x0f) << 2) | (uin[idx + 2] >> 6)];
+      out[idx2 + 3] = charset[uin[idx + 2] & 0x3F];
       // The offical standard requires a newline every 76 characters.
       // (Eg, first newline is character 77 of the output.)
       if (((idx2 - newline_count + 4) % NEWLINE_INVL == 0) && newline_flag) {
@@ -67,22 +289,26 @@ size_t base64_encode(const BYTE in[], BYTE out[], size_t len, int newline_flag)
     }
 
     if (left_over == 1) {
-      out[idx2]     = charset[in[idx] >> 2];
-      out[idx2 + 1] = charset[(in[idx] & 0x03) << 4];
+      out[idx2]     = charset[uin[idx] >> 2];
+      out[idx2 + 1] = charset[(uin[idx] & 0x03) << 4];
       out[idx2 + 2] = '=';
       out[idx2 + 3] = '=';
       idx2 += 4;
     }
     else if (left_over == 2) {
-      out[idx2]     = charset[in[idx] >> 2];
-      out[idx2 + 1] = charset[((in[idx] & 0x03) << 4) | (in[idx + 1] >> 4)];
-      out[idx2 + 2] = charset[(in[idx + 1] & 0x0F) << 2];
+      out[idx2]     = charset[uin[idx] >> 2];
+      out[idx2 + 1] = charset[((uin[idx] & 0x03) << 4) | (uin[idx + 1] >> 4)];
+      out[idx2 + 2] = charset[(uin[idx + 1] & 0x0F) << 2];
       out[idx2 + 3] = '=';
       idx2 += 4;
     }
+
+    // Padding within the first 256 characters is replaced by NULs and not
+    // counted. Only the characters just written are examined.
+    size_t scan = idx2 < 256 ? idx2 : 256;
+    for (size_t index = 0; index < scan; index++)
+      if (out[index] == '=') { out[index] = '\0'; idx2--; }
   }
-        for (int index=0; index<256; index++)
-           if(out[index]=='=') { out[index]='\0'; idx2--; } 
   return(idx2);
 }
 
@@ -90,9 +316,11 @@ size_t base64_decode(const BYTE in[], BYTE out[], size_t len)
 {
   size_t idx, idx2, blks, blk_ceiling, left_over;
 
+  if (len == 0)
+    return 0;
   if (in[len - 1] == '=')
     len--;
-  if (in[len - 1] == '=')
+  if (len > 0 && in[len - 1] == '=')
     len--;
 
   blks = len / 4;
@@ -112,21 +340,22 @@ size_t base64_decode(const BYTE in[], BYTE out[], size_t len)
   }
   else {
     blk_ceiling = blks * 4;
-    for (idx = 0, idx2 = 0; idx2 < blk_ceiling; idx += 3, idx2 += 4) {
+    idx2 = kernels().decode(reinterpret_cast<const unsigned char*>(in), blk_ceiling, out);
+    for (idx = idx2 / 4 * 3; idx2 < blk_ceiling; idx += 3, idx2 += 4) {
       if (in[idx2] == '\n')
         idx2++;
-      out[idx]     = (revchar(in[idx2]) << 2) | ((revchar(in[idx2 + 1]) & 0x30) >> 4);
-      out[idx + 1] = (revchar(in[idx2 + 1]) << 4) | (revchar(in[idx2 + 2]) >> 2);
-      out[idx + 2] = (revchar(in[idx2 + 2]) << 6) | revchar(in[idx2 + 3]);
+      out[idx]     = (revtable[in[idx2]] << 2) | ((revtable[in[idx2 + 1]] & 0x30) >> 4);
+      out[idx + 1] = (revtable[in[idx2 + 1]] << 4) | (revtable[in[idx2 + 2]] >> 2);
+      out[idx + 2] = (revtable[in[idx2 + 2]] << 6) | revtable[in[idx2 + 3]];
     }
 
     if (left_over == 2) {
-      out[idx]     = (revchar(in[idx2]) << 2) | ((revchar(in[idx2 + 1]) & 0x30) >> 4);
+      out[idx]     = (revtable[in[idx2]] << 2) | ((revtable[in[idx2 + 1]] & 0x30) >> 4);
       idx++;
     }
     else if (left_over == 3) {
-      out[idx]     = (revchar(in[idx2]) << 2) | ((revchar(in[idx2 + 1]) & 0x30) >> 4);
-      out[idx + 1] = (revchar(in[idx2 + 1]) << 4) | (revchar(in[idx2 + 2]) >> 2);
+      out[idx]     = (revtable[in[idx2]] << 2) | ((revtable[in[idx2 + 1]] & 0x30) >> 4);
+      out[idx + 1] = (revtable[in[idx2 + 1]] << 4) | (revtable[in[idx2 + 2]] >> 2);
       idx += 2;
     }
   }
@@ -0,0 +1,762 @@
+// Benchmark suite for HashTable, PassServer and base64. It needs no input
+// files and no services: every run generates its own synthetic users from a
+// seed, and the same generator writes password files for proj6 and
+// PassServer::load.
+//
+// Micro benchmarks time insert, rehash, contains, match, remove, write and
+// load on both HashTable layouts at each table size, each with std::hash and
+// with fast_hash, plus base64_encode and base64_decode. Macro benchmarks time
+// the same paths through PassServer, which adds encryption, the node arena
+// and raw value storage. Lookups draw users from a Zipf distribution, so
+// --skew 0 is uniform and larger values concentrate the traffic on fewer
+// users.
+//
+// Results go to stdout as one JSON document. Each result has ns_per_op, the
+// best of --rounds runs, ops_per_sec derived from it, and peak_rss_kb, the
+// peak resident size of the process so far. Sizes run in ascending order,
+// so a result's peak covers its own size and every smaller one.
+// "rehash" is the extra time per entry when a table grows from the default
+// size instead of being sized up front.
+//
+// Password hashing runs on up to 256 users of the largest size with
+// --iterations PBKDF2 iterations: "pbkdf2_xN" derives keys N lanes at a time,
+// and "passserver_hashed" adds, matches and batch matches users of a hashed
+// PassServer. The bench runs on one thread, so their ops_per_sec are
+// verifications per second on one core.
+//
+// "find_stuffing" and "match_stuffing" replay the lookups with --miss-rate
+// of them turned into users who do not exist, as in credential stuffing,
+// on a PassServer without and with ("passserver_filtered") the negative
+// filter.
+//
+// "copy" and "cow_snapshot" are what an image of a PassServer's table costs
+// the thread that owns it, per entry: a deep copy, as compact() used to
+// make, against a copy-on-write snapshot. "churn" times removeUser/addUser
+// pairs, and "churn_writing" the same while another thread writes a
+// snapshot's password file.
+//
+// "bulk_build" builds a table from all the users at once and "rehash_all"
+// grows a full table by a single rehash, on every hardware thread and, with
+// the suffix "_1t", on one; "insert_reserved" is the same build one insert
+// at a time.
+//
+// Build: make bench
+// Usage: bench [--sizes 1000,100000,1000000] [--queries N] [--key-length MIN:MAX]
+//              [--password-length MIN:MAX] [--skew S] [--seed N] [--rounds N] [--file PATH]
+//              [--iterations N] [--cache-entries N] [--hashed-queries N] [--miss-rate R]
+//        bench --generate FILE [--users N] [--key-length MIN:MAX] [--password-length MIN:MAX] [--seed N]
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/resource.h>
+#include "hashtable.h"
+#include "passserver.h"
+#include "base64.h"
+#include "sha256.h"
+
+using namespace cop4530;
+
+// results are summed here so the timed calls cannot be optimized away
+static volatile size_t sink = 0;
+
+struct Options {
+    std::vector<size_t> sizes{1000, 100000, 1000000};
+    size_t queries = 1000000;
+    size_t keyMin = 8, keyMax = 16;
+    size_t passwordMin = 8, passwordMax = 16;
+    double skew = 0.99;
+    unsigned long seed = 1;
+    size_t rounds = 3;
+    std::string file = "bench.tmp";
+    std::string generate;
+    size_t users = 100000;
+    uint32_t iterations = 1000;
+    size_t cacheEntries = 1000;
+    size_t hashedQueries = 10000;
+    double missRate = 0.9;
+};
+
+// Synthetic users. Key i begins with i in base 36, so keys are unique, and
+// is padded with random characters to a length drawn from [keyMin, keyMax].
+// Passwords contain no whitespace, so they survive the password file format.
+struct Dataset {
+    std::vector<std::pair<std::string, std::string>> users;
+    std::vector<size_t> lookups; // indexes into users, Zipf distributed
+};
+
+static const char alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+static std::string randomText(std::mt19937_64& rng, std::string text, size_t min, size_t max) {
+    size_t length = min + rng() % (max - min + 1);
+    while (text.size() < length) {
+        text += alphabet[rng() % (sizeof(alphabet) - 1)];
+    }
+    return text;
+}
+
+static std::string base36(size_t i) {
+    std::string digits;
+    do {
+        digits += alphabet[i % 36];
+        i /= 36;
+    } while (i > 0);
+    return digits;
+}
+
+static std::vector<std::pair<std::string, std::string>> makeUsers(size_t count, const Options& opt, std::mt19937_64& rng) {
+    std::vector<std::pair<std::string, std::string>> users;
+    users.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        users.emplace_back(randomText(rng, base36(i), opt.keyMin, opt.keyMax),
+                           randomText(rng, std::string(), opt.passwordMin, opt.passwordMax));
+    }
+    return users;
+}
+
+// Draws count ranks from Zipf(skew) over n users by inverting the CDF, then
+// scatters the ranks over the users so the hot ones are not neighbours.
+static std::vector<size_t> makeLookups(size_t n, size_t count, double skew, std::mt19937_64& rng) {
+    std::vector<size_t> lookups(count);
+    if (skew <= 0) {
+        for (auto& l : lookups) {
+            l = rng() % n;
+        }
+        return lookups;
+    }
+    std::vector<double> cdf(n);
+    double total = 0;
+    for (size_t r = 0; r < n; ++r) {
+        total += 1.0 / std::pow(static_cast<double>(r + 1), skew);
+        cdf[r] = total;
+    }
+    std::vector<size_t> scatter(n);
+    for (size_t i = 0; i < n; ++i) {
+        scatter[i] = i;
+    }
+    std::shuffle(scatter.begin(), scatter.end(), rng);
+    std::uniform_real_distribution<double> uniform(0, total);
+    for (auto& l : lookups) {
+        size_t rank = std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin();
+        l = scatter[std::min(rank, n - 1)];
+    }
+    return lookups;
+}
+
+static size_t peakRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_maxrss);
+}
+
+struct Result {
+    std::string group;
+    std::string subject;
+    size_t size;
+    std::string op;
+    double nsPerOp;
+    size_t peakRssKb;
+    double hitRate;           // verify cache results only, otherwise negative
+    double falsePositiveRate; // negative filter results only, otherwise negative
+};
+
+static std::vector<Result> results;
+
+static void record(const std::string& group, const std::string& subject, size_t size, const std::string& op,
+                   double nsPerOp, double hitRate = -1, double falsePositiveRate = -1) {
+    results.push_back({group, subject, size, op, std::max(nsPerOp, 0.0), peakRssKb(), hitRate, falsePositiveRate});
+    std::cerr << std::setw(6) << group << std::setw(29) << subject << std::setw(9) << size << std::setw(15) << op
+              << std::setw(11) << std::fixed << std::setprecision(1) << std::max(nsPerOp, 0.0) << " ns/op";
+    if (hitRate >= 0) {
+        std::cerr << std::setw(8) << std::setprecision(3) << hitRate << " hit rate";
+    }
+    if (falsePositiveRate >= 0) {
+        std::cerr << std::setw(10) << std::setprecision(6) << falsePositiveRate << " false positive rate";
+    }
+    std::cerr << "\n";
+}
+
+// Best time in nanoseconds per op of rounds calls to run(), each preceded by
+// an untimed setup()
+template <typename Setup, typename Run>
+static double best(size_t rounds, size_t ops, Setup setup, Run run) {
+    double fastest = 0;
+    for (size_t r = 0; r < rounds; ++r) {
+        setup();
+        auto start = std::chrono::steady_clock::now();
+        run();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (r == 0 || ns < fastest) {
+            fastest = ns;
+        }
+    }
+    return fastest / std::max<size_t>(ops, 1);
+}
+
+static void noSetup() {}
+
+static void fail(const char* what) {
+    std::cerr << "** " << what << " failed\n";
+    std::exit(1);
+}
+
+// The HashTable paths on one layout. Values are inserted as given, so the
+// table's own encoding is part of what insert, match and write cost.
+template <typename Table>
+static void microTable(const char* layout, const Dataset& data, const Options& opt) {
+    size_t n = data.users.size();
+    Table table(n);
+    double presized = best(opt.rounds, n, [&] { table.clear(); }, [&] {
+        for (const auto& kv : data.users) {
+            table.insert(kv);
+        }
+    });
+    record("micro", layout, n, "insert", presized);
+
+    std::unique_ptr<Table> fresh;
+    double growing = best(opt.rounds, n, [&] { fresh.reset(new Table()); }, [&] {
+        for (const auto& kv : data.users) {
+            fresh->insert(kv);
+        }
+    });
+    fresh.reset();
+    record("micro", layout, n, "rehash", growing - presized);
+
+    table.clear();
+    for (const auto& kv : data.users) {
+        table.insert(kv);
+    }
+    record("micro", layout, n, "contains", best(opt.rounds, data.lookups.size(), noSetup, [&] {
+        size_t hits = 0;
+        for (size_t i : data.lookups) {
+            hits += table.contains(data.users[i].first);
+        }
+        sink = sink + hits;
+    }));
+
+    std::vector<std::string> missing(std::min(n, data.lookups.size()));
+    for (size_t i = 0; i < missing.size(); ++i) {
+        missing[i] = "~" + data.users[data.lookups[i]].first;
+    }
+    record("micro", layout, n, "contains_miss", best(opt.rounds, missing.size(), noSetup, [&] {
+        size_t hits = 0;
+        for (const auto& k : missing) {
+            hits += table.contains(k);
+        }
+        sink = sink + hits;
+    }));
+
+    record("micro", layout, n, "match", best(opt.rounds, data.lookups.size(), noSetup, [&] {
+        size_t hits = 0;
+        for (size_t i : data.lookups) {
+            hits += table.match(data.users[i]);
+        }
+        sink = sink + hits;
+    }));
+
+    std::ostringstream sizing;
+    table.write(sizing);
+    size_t bytes = sizing.str().size();
+    record("micro", layout, n, "write", best(opt.rounds, n, noSetup, [&] {
+        if (!table.write(opt.file.c_str())) {
+            fail("write");
+        }
+    }));
+    record("micro", layout, n, "load", best(opt.rounds, n, noSetup, [&] {
+        if (!table.load(opt.file.c_str()) || table.size() != n) {
+            fail("load");
+        }
+    }));
+    sink = sink + bytes;
+
+    record("micro", layout, n, "remove", best(opt.rounds, n, [&] {
+        table.clear();
+        for (const auto& kv : data.users) {
+            table.insert(kv);
+        }
+    }, [&] {
+        size_t removed = 0;
+        for (const auto& kv : data.users) {
+            removed += table.remove(kv.first);
+        }
+        sink = sink + removed;
+    }));
+}
+
+// The PassServer paths, from a plain password file through to the file
+// write_to_file produces
+static void macroPassServer(const Dataset& data, const Options& opt) {
+    size_t n = data.users.size();
+    {
+        std::ofstream out(opt.file);
+        for (const auto& kv : data.users) {
+            out << kv.first << " " << kv.second << "\n";
+        }
+        if (!out) {
+            fail("writing the password file");
+        }
+    }
+    PassServer ps(n);
+    record("macro", "passserver", n, "load", best(opt.rounds, n, noSetup, [&] {
+        if (!ps.load(opt.file.c_str()) || ps.size() != n) {
+            fail("load");
+        }
+    }));
+    record("macro", "passserver", n, "find", best(opt.rounds, data.lookups.size(), noSetup, [&] {
+        size_t hits = 0;
+        for (size_t i : data.lookups) {
+            hits += ps.find(data.users[i].first);
+        }
+        sink = sink + hits;
+    }));
+    record("macro", "passserver", n, "match", best(opt.rounds, data.lookups.size(), noSetup, [&] {
+        size_t hits = 0;
+        for (size_t i : data.lookups) {
+            hits += ps.match(data.users[i]);
+        }
+        sink = sink + hits;
+    }));
+    record("macro", "passserver", n, "write_to_file", best(opt.rounds, n, noSetup, [&] {
+        if (!ps.write_to_file(opt.file.c_str())) {
+            fail("write_to_file");
+        }
+    }));
+    record("macro", "passserver", n, "removeUser", best(opt.rounds, n, [&] {
+        if (!ps.load(opt.file.c_str())) {
+            fail("load");
+        }
+    }, [&] {
+        size_t removed = 0;
+        for (const auto& kv : data.users) {
+            removed += ps.removeUser(kv.first);
+        }
+        sink = sink + removed;
+    }));
+    record("macro", "passserver", n, "addUser", best(opt.rounds, n, [&] {
+        for (const auto& kv : data.users) {
+            ps.removeUser(kv.first);
+        }
+    }, [&] {
+        size_t added = 0;
+        for (const auto& kv : data.users) {
+            added += ps.addUser(std::make_pair(kv.first, kv.second));
+        }
+        sink = sink + added;
+    }));
+}
+
+// base64 on the generated passwords, which is the input PassServer gives it
+static void microBase64(const Dataset& data, const Options& opt) {
+    size_t count = std::min<size_t>(data.users.size(), 100000);
+    std::vector<std::string> encoded(count);
+    std::vector<char> buffer((opt.passwordMax + 2) / 3 * 4 + 4);
+    double encode = best(opt.rounds, count, noSetup, [&] {
+        size_t total = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const std::string& pw = data.users[i].second;
+            total += base64_encode(pw.data(), buffer.data(), pw.size(), 0);
+        }
+        sink = sink + total;
+    });
+    for (size_t i = 0; i < count; ++i) {
+        const std::string& pw = data.users[i].second;
+        encoded[i].assign(buffer.data(), base64_encode(pw.data(), buffer.data(), pw.size(), 0));
+    }
+    double decode = best(opt.rounds, count, noSetup, [&] {
+        size_t total = 0;
+        for (const auto& text : encoded) {
+            total += base64_decode(text.data(), buffer.data(), text.size());
+        }
+        sink = sink + total;
+    });
+    record("micro", "base64", count, "base64_encode", encode);
+    record("micro", "base64", count, "base64_decode", decode);
+}
+
+// PBKDF2-HMAC-SHA256 at each lane width this CPU has, one derived key per op
+static void microPbkdf2(const Dataset& data, const Options& opt) {
+    size_t count = std::min<size_t>(data.users.size(), 256);
+    std::vector<unsigned char> keys(count * sha256_bytes);
+    std::vector<Pbkdf2Job> jobs;
+    for (size_t i = 0; i < count; ++i) {
+        // the user names serve as distinct salts
+        jobs.push_back({data.users[i].second, data.users[i].first, &keys[i * sha256_bytes]});
+    }
+    for (size_t lanes = 1; lanes <= pbkdf2_sha256_lanes(); lanes = lanes == 1 ? 4 : lanes * 2) {
+        record("micro", "pbkdf2_x" + std::to_string(lanes), count, "derive", best(opt.rounds, count, noSetup, [&] {
+            pbkdf2_sha256_many(jobs.data(), jobs.size(), opt.iterations, lanes);
+            sink = sink + keys[0];
+        }));
+    }
+}
+
+// Logins on a PassServer in hashed mode: users added in a batch, then
+// checked one match at a time and in one match_many
+static void macroHashed(const Dataset& data, const Options& opt) {
+    size_t count = std::min<size_t>(data.users.size(), 256);
+    std::vector<std::pair<std::string, std::string>> users(data.users.begin(), data.users.begin() + count);
+    PassServer ps(count);
+    ps.set_password_storage(password_storage::hashed, opt.iterations);
+    record("macro", "passserver_hashed", count, "addUser_many", best(opt.rounds, count, [&] {
+        for (const auto& kv : users) {
+            ps.removeUser(kv.first);
+        }
+    }, [&] {
+        auto added = ps.addUser_many(users);
+        sink = sink + std::count(added.begin(), added.end(), true);
+    }));
+    record("macro", "passserver_hashed", count, "match", best(opt.rounds, count, noSetup, [&] {
+        size_t hits = 0;
+        for (const auto& kv : users) {
+            hits += ps.match(kv);
+        }
+        if (hits != count) {
+            fail("match");
+        }
+        sink = sink + hits;
+    }));
+    record("macro", "passserver_hashed", count, "match_many", best(opt.rounds, count, noSetup, [&] {
+        auto matched = ps.match_many(users);
+        if (static_cast<size_t>(std::count(matched.begin(), matched.end(), true)) != count) {
+            fail("match_many");
+        }
+        sink = sink + count;
+    }));
+}
+
+// The Zipf distributed logins replayed through a verify cache of
+// --cache-entries, which starts cold in every round. Encoded PassServers
+// replay every lookup; hashed ones the first --hashed-queries, since each
+// miss derives a key. Compare with "match" of passserver and
+// passserver_hashed; hit_rate is that of the last round.
+static void macroCached(const Dataset& data, const Options& opt) {
+    size_t n = data.users.size();
+    for (int hashed = 0; hashed < 2; ++hashed) {
+        PassServer ps(n);
+        size_t queries = data.lookups.size();
+        if (hashed) {
+            // only the users replayed are added, as each takes a key derivation
+            ps.set_password_storage(password_storage::hashed, opt.iterations);
+            queries = std::min(opt.hashedQueries, queries);
+            std::vector<std::pair<std::string, std::string>> replayed;
+            for (size_t q = 0; q < queries; ++q) {
+                replayed.push_back(data.users[data.lookups[q]]);
+            }
+            ps.addUser_many(replayed);
+        } else {
+            for (const auto& kv : data.users) {
+                ps.addUser(std::make_pair(kv.first, kv.second));
+            }
+        }
+        double ns = best(opt.rounds, queries, [&] { ps.set_verify_cache(opt.cacheEntries); }, [&] {
+            size_t hits = 0;
+            for (size_t q = 0; q < queries; ++q) {
+                hits += ps.match(data.users[data.lookups[q]]);
+            }
+            if (hits != queries) {
+                fail("match");
+            }
+            sink = sink + hits;
+        });
+        record("macro", hashed ? "passserver_hashed_cached" : "passserver_cached", n, "match", ns,
+               ps.cache_stats().hit_rate);
+    }
+}
+
+// The lookups replayed as credential stuffing: --miss-rate of them name a
+// user who does not exist. Runs without and with the negative filter; the
+// filtered results carry the false-positive rate its stats() report.
+static void macroFiltered(const Dataset& data, const Options& opt) {
+    size_t n = data.users.size();
+    std::mt19937_64 rng(opt.seed + n);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::vector<std::pair<std::string, std::string>> attempts;
+    attempts.reserve(data.lookups.size());
+    for (size_t i : data.lookups) {
+        attempts.push_back(data.users[i]);
+        if (uniform(rng) < opt.missRate) {
+            attempts.back().first.insert(0, 1, '~');
+        }
+    }
+    for (int filtered = 0; filtered < 2; ++filtered) {
+        PassServer ps(n);
+        ps.set_negative_filter(filtered);
+        for (const auto& kv : data.users) {
+            ps.addUser(std::make_pair(kv.first, kv.second));
+        }
+        const char* subject = filtered ? "passserver_filtered" : "passserver";
+        double find = best(opt.rounds, attempts.size(), noSetup, [&] {
+            size_t hits = 0;
+            for (const auto& kv : attempts) {
+                hits += ps.find(kv.first);
+            }
+            sink = sink + hits;
+        });
+        double match = best(opt.rounds, attempts.size(), noSetup, [&] {
+            size_t hits = 0;
+            for (const auto& kv : attempts) {
+                hits += ps.match(kv);
+            }
+            sink = sink + hits;
+        });
+        double rate = filtered ? ps.stats().filter_false_positive_rate : -1;
+        record("macro", subject, n, "find_stuffing", find, -1, rate);
+        record("macro", subject, n, "match_stuffing", match, -1, rate);
+    }
+}
+
+// The cost of an image of a PassServer table to the thread that changes it
+static void macroSnapshot(const Dataset& data, const Options& opt) {
+    size_t n = data.users.size();
+    PassServer::Table table(n);
+    table.set_value_storage(value_storage::raw);
+    for (const auto& kv : data.users) {
+        table.insert(kv);
+    }
+    std::unique_ptr<PassServer::Table> copy;
+    record("macro", "passserver_table", n, "copy", best(opt.rounds, n, [&] { copy.reset(); }, [&] {
+        copy.reset(new PassServer::Table(table));
+    }));
+    copy.reset();
+    std::shared_ptr<const PassServer::Snapshot> image;
+    record("macro", "passserver_table", n, "cow_snapshot", best(opt.rounds, n, [&] { image.reset(); }, [&] {
+        image = table.cow_snapshot();
+    }));
+    image.reset();
+
+    // each pair removes a user and adds it back, so the table keeps its size
+    size_t pairs = std::min(n, data.lookups.size());
+    auto churn = [&] {
+        for (size_t q = 0; q < pairs; ++q) {
+            const auto& kv = data.users[data.lookups[q]];
+            table.remove(kv.first);
+            table.insert(kv);
+        }
+    };
+    record("macro", "passserver_table", n, "churn", best(opt.rounds, pairs, noSetup, churn));
+    std::thread writer;
+    record("macro", "passserver_table", n, "churn_writing", best(opt.rounds, pairs, [&] {
+        if (writer.joinable()) {
+            writer.join();
+        }
+        image = table.cow_snapshot();
+        writer = std::thread([&opt, image] {
+            if (!image->write(opt.file.c_str())) {
+                fail("writing the snapshot");
+            }
+        });
+    }, churn));
+    writer.join();
+}
+
+// Building a table from pairs and rehashing all of it, on one thread and on
+// as many as the hardware runs
+static void microBulk(const Dataset& data, const Options& opt) {
+    typedef HashTable<std::string, std::string, separate_chaining, std::allocator<std::pair<std::string, std::string>>,
+                      fast_hash<std::string>> Table;
+    const char* subject = "separate_chaining+fast_hash";
+    size_t n = data.users.size();
+    Table table;
+    record("micro", subject, n, "insert_reserved", best(opt.rounds, n, [&] { table.clear(); }, [&] {
+        table.reserve(n);
+        for (const auto& kv : data.users) {
+            table.insert(kv);
+        }
+    }));
+    for (size_t threads : {size_t(1), size_t(0)}) {
+        table.set_build_threads(threads);
+        std::string suffix = threads ? "_1t" : "";
+        record("micro", subject, n, "bulk_build" + suffix, best(opt.rounds, n, [&] { table.clear(); }, [&] {
+            table.bulk_build(data.users);
+        }));
+        // a table sized for n grows once, moving every entry
+        std::unique_ptr<Table> full;
+        record("micro", subject, n, "rehash_all" + suffix, best(opt.rounds, n, [&] {
+            full.reset(new Table);
+            full->set_build_threads(threads);
+            full->bulk_build(data.users);
+        }, [&] {
+            full->reserve(2 * n);
+        }));
+    }
+    if (table.size() != n) {
+        fail("bulk_build");
+    }
+}
+
+static std::string jsonString(const std::string& s) {
+    std::string quoted = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+static void printJson(const Options& opt) {
+    std::cout << "{\n  \"seed\": " << opt.seed << ",\n  \"rounds\": " << opt.rounds
+              << ",\n  \"queries\": " << opt.queries << ",\n  \"skew\": " << opt.skew
+              << ",\n  \"key_length\": [" << opt.keyMin << ", " << opt.keyMax << "]"
+              << ",\n  \"password_length\": [" << opt.passwordMin << ", " << opt.passwordMax << "]"
+              << ",\n  \"hash_iterations\": " << opt.iterations
+              << ",\n  \"miss_rate\": " << opt.missRate
+              << ",\n  \"hardware_threads\": " << std::thread::hardware_concurrency()
+              << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::cout << (i ? ",\n" : "\n") << std::fixed << std::setprecision(2)
+                  << "    {\"group\": " << jsonString(r.group) << ", \"subject\": " << jsonString(r.subject)
+                  << ", \"size\": " << r.size << ", \"op\": " << jsonString(r.op)
+                  << ", \"ns_per_op\": " << r.nsPerOp
+                  << ", \"ops_per_sec\": " << std::setprecision(0) << (r.nsPerOp > 0 ? 1e9 / r.nsPerOp : 0)
+                  << ", \"peak_rss_kb\": " << r.peakRssKb;
+        if (r.hitRate >= 0) {
+            std::cout << std::setprecision(4) << ", \"hit_rate\": " << r.hitRate;
+        }
+        if (r.falsePositiveRate >= 0) {
+            std::cout << std::setprecision(6) << ", \"false_positive_rate\": " << r.falsePositiveRate;
+        }
+        std::cout << "}";
+    }
+    std::cout << "\n  ]\n}\n";
+}
+
+// Parses "MIN:MAX" or a single length into [min, max]
+static bool parseRange(const char* text, size_t& min, size_t& max) {
+    char* end;
+    min = std::strtoul(text, &end, 10);
+    max = *end == ':' ? std::strtoul(end + 1, &end, 10) : min;
+    return *end == '\0' && min >= 1 && min <= max;
+}
+
+static bool parseSizes(const char* text, std::vector<size_t>& sizes) {
+    sizes.clear();
+    std::stringstream list(text);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        size_t size = std::strtoul(item.c_str(), nullptr, 10);
+        if (size < 1) {
+            return false;
+        }
+        sizes.push_back(size);
+    }
+    std::sort(sizes.begin(), sizes.end());
+    return !sizes.empty();
+}
+
+static bool parseOptions(int argc, char* argv[], Options& opt) {
+    for (int i = 1; i < argc; i += 2) {
+        std::string name = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "** " << name << " needs a value\n";
+            return false;
+        }
+        const char* value = argv[i + 1];
+        bool ok = true;
+        if (name == "--sizes") {
+            ok = parseSizes(value, opt.sizes);
+        } else if (name == "--queries") {
+            opt.queries = std::strtoul(value, nullptr, 10);
+            ok = opt.queries > 0;
+        } else if (name == "--key-length") {
+            ok = parseRange(value, opt.keyMin, opt.keyMax);
+        } else if (name == "--password-length") {
+            ok = parseRange(value, opt.passwordMin, opt.passwordMax);
+        } else if (name == "--skew") {
+            opt.skew = std::atof(value);
+            ok = opt.skew >= 0;
+        } else if (name == "--seed") {
+            opt.seed = std::strtoul(value, nullptr, 10);
+        } else if (name == "--rounds") {
+            opt.rounds = std::strtoul(value, nullptr, 10);
+            ok = opt.rounds > 0;
+        } else if (name == "--file") {
+            opt.file = value;
+        } else if (name == "--generate") {
+            opt.generate = value;
+        } else if (name == "--users") {
+            opt.users = std::strtoul(value, nullptr, 10);
+            ok = opt.users > 0;
+        } else if (name == "--cache-entries") {
+            opt.cacheEntries = std::strtoul(value, nullptr, 10);
+            ok = opt.cacheEntries > 0;
+        } else if (name == "--hashed-queries") {
+            opt.hashedQueries = std::strtoul(value, nullptr, 10);
+            ok = opt.hashedQueries > 0;
+        } else if (name == "--miss-rate") {
+            opt.missRate = std::atof(value);
+            ok = opt.missRate >= 0 && opt.missRate <= 1;
+        } else if (name == "--iterations") {
+            opt.iterations = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+            ok = opt.iterations > 0;
+        } else {
+            std::cerr << "** Unknown option " << name << "\n";
+            return false;
+        }
+        if (!ok) {
+            std::cerr << "** Invalid value for " << name << ": " << value << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) {
+        return 1;
+    }
+    std::mt19937_64 rng(opt.seed);
+
+    if (!opt.generate.empty()) {
+        std::ofstream out(opt.generate);
+        for (const auto& kv : makeUsers(opt.users, opt, rng)) {
+            out << kv.first << " " << kv.second << "\n";
+        }
+        if (!out) {
+            std::cerr << "** Unable to write " << opt.generate << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    std::vector<std::pair<std::string, std::string>> all = makeUsers(opt.sizes.back(), opt, rng);
+    for (size_t size : opt.sizes) {
+        Dataset data;
+        data.users.assign(all.begin(), all.begin() + size);
+        data.lookups = makeLookups(size, opt.queries, opt.skew, rng);
+        microTable<HashTable<std::string, std::string>>("separate_chaining", data, opt);
+        microTable<HashTable<std::string, std::string, open_addressing>>("open_addressing", data, opt);
+        microTable<HashTable<std::string, std::string, separate_chaining, std::allocator<std::pair<std::string, std::string>>,
+                             fast_hash<std::string>>>("separate_chaining+fast_hash", data, opt);
+        microTable<HashTable<std::string, std::string, open_addressing, std::allocator<std::pair<std::string, std::string>>,
+                             fast_hash<std::string>>>("open_addressing+fast_hash", data, opt);
+        macroPassServer(data, opt);
+        macroCached(data, opt);
+        macroFiltered(data, opt);
+        macroSnapshot(data, opt);
+        microBulk(data, opt);
+        if (size == opt.sizes.back()) {
+            microBase64(data, opt);
+            microPbkdf2(data, opt);
+            macroHashed(data, opt);
+        }
+    }
+    std::remove(opt.file.c_str());
+    printJson(opt);
+    return 0;
+}
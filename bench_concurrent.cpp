@@ -0,0 +1,93 @@
+// Throughput of ConcurrentPassServer as the number of threads grows.
+//
+// Build: make bench_concurrent
+// Usage: bench_concurrent [users] [ops per thread] [max threads] [write percent] [shards]
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <atomic>
+#include "concurrentpassserver.h"
+
+using namespace cop4530;
+
+// results are summed here so the lookups cannot be optimized away
+static std::atomic<size_t> sink(0);
+
+static std::string userName(size_t i) {
+    return "user" + std::to_string(i);
+}
+
+static std::string password(size_t i) {
+    return "pw" + std::to_string(i * 2654435761u % 1000003);
+}
+
+// One worker: mostly find/match on existing users, plus write_percent
+// add/remove pairs on users private to this thread.
+static void worker(ConcurrentPassServer& ps, size_t id, size_t users, size_t ops, unsigned writePercent) {
+    std::mt19937_64 rng(id + 1);
+    size_t hits = 0;
+    size_t added = 0;
+    for (size_t i = 0; i < ops; ++i) {
+        size_t r = rng();
+        if (r % 100 < writePercent) {
+            std::string own = "t" + std::to_string(id) + "_" + std::to_string(added / 2);
+            if (added++ % 2 == 0) {
+                ps.addUser(std::make_pair(own, std::string("secret")));
+            } else {
+                ps.removeUser(own);
+            }
+        } else {
+            size_t u = (r >> 8) % users;
+            if (r & 0x80) {
+                hits += ps.find(userName(u));
+            } else {
+                hits += ps.match(std::make_pair(userName(u), password(u)));
+            }
+        }
+    }
+    sink += hits;
+}
+
+int main(int argc, char* argv[]) {
+    size_t users = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    size_t ops = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+    size_t maxThreads = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : std::thread::hardware_concurrency();
+    unsigned writePercent = argc > 4 ? std::atoi(argv[4]) : 1;
+    size_t shardCount = argc > 5 ? std::strtoul(argv[5], nullptr, 10) : 64;
+    if (maxThreads < 1) {
+        maxThreads = 1;
+    }
+
+    ConcurrentPassServer ps(users, shardCount);
+    for (size_t i = 0; i < users; ++i) {
+        ps.addUser(std::make_pair(userName(i), password(i)));
+    }
+
+    std::cout << "users " << users << ", shards " << shardCount << ", " << writePercent << "% writes\n";
+    std::cout << std::setw(8) << "threads" << std::setw(16) << "ops/sec" << std::setw(10) << "speedup" << "\n";
+    double base = 0;
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        std::vector<std::thread> pool;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t t = 0; t < threads; ++t) {
+            pool.emplace_back(worker, std::ref(ps), t, users, ops, writePercent);
+        }
+        for (auto& th : pool) {
+            th.join();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double rate = threads * ops / seconds;
+        if (threads == 1) {
+            base = rate;
+        }
+        std::cout << std::setw(8) << threads << std::setw(16) << std::fixed << std::setprecision(0) << rate
+                  << std::setw(10) << std::setprecision(2) << rate / base << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+// Throughput of HashTable::write for both layouts: formatting into a stream
+// that is never flushed to disk, and the atomic write to a file that is
+// fsynced and renamed into place.
+//
+// Build: make bench_write
+// Usage: bench_write [users] [output file] [rounds]
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include "hashtable.h"
+#include "flathashtable.h"
+
+using namespace cop4530;
+
+static std::string userName(size_t i) {
+    return "user" + std::to_string(i);
+}
+
+static std::string password(size_t i) {
+    return "pw" + std::to_string(i * 2654435761u % 1000003);
+}
+
+// Best time in seconds of rounds calls to run()
+template <typename F>
+static double best(size_t rounds, F run) {
+    double fastest = 0;
+    for (size_t r = 0; r < rounds; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        if (!run()) {
+            std::cerr << "** write failed\n";
+            std::exit(1);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (r == 0 || seconds < fastest) {
+            fastest = seconds;
+        }
+    }
+    return fastest;
+}
+
+template <typename Table>
+static void measure(const char* name, size_t users, const char* filename, size_t rounds) {
+    Table table(users);
+    for (size_t i = 0; i < users; ++i) {
+        table.insert(std::make_pair(userName(i), password(i)));
+    }
+    std::ostringstream sizing;
+    table.write(sizing);
+    double megabytes = sizing.str().size() / 1e6;
+
+    double stream = best(rounds, [&table] {
+        std::ostringstream out;
+        return table.write(out);
+    });
+    double file = best(rounds, [&table, filename] {
+        return table.write(filename);
+    });
+    std::cout << std::setw(18) << name << std::fixed << std::setprecision(1)
+              << std::setw(12) << megabytes / stream << std::setw(12) << megabytes / file << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    size_t users = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const char* filename = argc > 2 ? argv[2] : "bench_write.out";
+    size_t rounds = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 3;
+    if (rounds < 1) {
+        rounds = 1;
+    }
+
+    std::cout << "users " << users << ", " << std::thread::hardware_concurrency() << " hardware threads\n";
+    std::cout << std::setw(18) << "layout" << std::setw(12) << "stream MB/s" << std::setw(12) << "file MB/s" << "\n";
+    measure<HashTable<std::string, std::string>>("separate_chaining", users, filename, rounds);
+    measure<HashTable<std::string, std::string, open_addressing>>("open_addressing", users, filename, rounds);
+    std::remove(filename);
+    return 0;
+}
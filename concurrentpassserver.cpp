@@ -0,0 +1,371 @@
+#include "concurrentpassserver.h"
+#include <mutex>
+
+namespace cop4530 {
+
+    // ***********************************************************************
+    // * Function Name: ConcurrentPassServer                                 *
+    // * Description: Constructor, creates the shards and splits the         *
+    // *              requested table size evenly between them               *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t size: The initial size of the whole hash table             *
+    // * - size_t shards: The number of independently locked shards          *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+ConcurrentPassServer::ConcurrentPassServer(size_t size, size_t shards) {
+    if (shards < 1) {
+        shards = 1;
+    }
+    for (size_t i = 0; i < shards; ++i) {
+        this->shards.emplace_back(new Shard(size / shards + 1));
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: ~ConcurrentPassServer                                *
+    // * Description: Destructor, clears every shard                         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+ConcurrentPassServer::~ConcurrentPassServer() {
+    for (auto& shard : shards) {
+        shard->table.clear();
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: load                                                 *
+    // * Description: Loads user password pairs from a file. The file is     *
+    // *              read and each shard's new contents sorted out before   *
+    // *              any lock is taken; the shards are then write locked in *
+    // *              order and each replaced in one step. Readers keep      *
+    // *              running and see every shard hold either all its old    *
+    // *              users or all its new ones                              *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* filename: name of the file to load from               *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool ConcurrentPassServer::load(const char* filename) {
+    MappedFile file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::vector<std::vector<std::pair<std::string, std::string>>> perShard(shards.size());
+    for_each_pair(file, filename, [&](std::string_view user, std::string_view password) {
+        std::string key(user);
+        perShard[shardIndex(key)].push_back({std::move(key), encrypt(std::string(password))});
+    });
+
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (auto& shard : shards) {
+        locks.emplace_back(shard->writeLock);
+    }
+    for (size_t i = 0; i < shards.size(); ++i) {
+        shards[i]->table.replace(std::move(perShard[i]));
+    }
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: addUser                                              *
+    // * Description: Adds a user password pair, locking only the user's     *
+    // *              shard. The password is encrypted before the lock       *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::pair<std::string, std::string>& kv: The user-password pair   *
+    // *                                            to add                   *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool ConcurrentPassServer::addUser(std::pair<std::string, std::string>& kv) {
+    return addUser(std::pair<std::string, std::string>(kv));
+}
+
+    // ***********************************************************************
+    // * Function Name: addUser                                              *
+    // * Description: Adds a user password pair using move                   *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::pair<std::string, std::string>&& kv: The user password pair  *
+    // *                                             to add                  *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool ConcurrentPassServer::addUser(std::pair<std::string, std::string>&& kv) {
+    kv.second = encrypt(kv.second);
+    Shard& shard = shardOf(kv.first);
+    std::lock_guard<std::mutex> guard(shard.writeLock);
+    return shard.table.insert(kv);
+}
+
+    // ***********************************************************************
+    // * Function Name: removeUser                                           *
+    // * Description: Removes a user, locking only the user's shard          *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::string& k: The username to remove                      *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool ConcurrentPassServer::removeUser(const std::string& k) {
+    Shard& shard = shardOf(k);
+    std::lock_guard<std::mutex> guard(shard.writeLock);
+    return shard.table.remove(k);
+}
+
+    // ***********************************************************************
+    // * Function Name: changePassword                                       *
+    // * Description: Changes the password of an existing user. The check   *
+    // *              of the old password and the update happen under the    *
+    // *              write lock of the user's shard. The entry is replaced  *
+    // *              in one step, so readers never miss the user            *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::pair<std::string, std::string>& p:  username and       *
+    // *                                                  old password       *
+    // * - const std::string& newpassword: new password                      *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool ConcurrentPassServer::changePassword(const std::pair<std::string, std::string>& p, const std::string& newpassword) {
+    if (newpassword == p.second) {
+        return false;
+    }
+    std::string encryptedOldPassword = encrypt(p.second);
+    std::string encryptedNewPassword = encrypt(newpassword);
+    Shard& shard = shardOf(p.first);
+    std::lock_guard<std::mutex> guard(shard.writeLock);
+    if (!shard.table.match({p.first, encryptedOldPassword})) {
+        return false;
+    }
+    return shard.table.update({p.first, encryptedNewPassword});
+}
+
+    // ***********************************************************************
+    // * Function Name: find                                                 *
+    // * Description: Checks if a user exists without taking a lock         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::string& user: the username to find                     *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool ConcurrentPassServer::find(const std::string& user) const {
+    return shardOf(user).table.contains(user);
+}
+
+    // ***********************************************************************
+    // * Function Name: match                                                *
+    // * Description: Checks a login, i.e. that the user exists and has the  *
+    // *              given plaintext password, without taking a lock        *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::pair<std::string, std::string>& kv: username and       *
+    // *                                                  password           *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool ConcurrentPassServer::match(const std::pair<std::string, std::string>& kv) const {
+    return shardOf(kv.first).table.match({kv.first, encrypt(kv.second)});
+}
+
+    // ***********************************************************************
+    // * Function Name: decodepw                                             *
+    // * Description: Finds and decrypts the password for a given user       *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::string& user: The username to find                     *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+std::string ConcurrentPassServer::decodepw(const std::string& user) const {
+    std::string encryptedPassword = shardOf(user).table.getpassword(user);
+    if (encryptedPassword == "NOT FOUND") {
+        return "NOT FOUND";
+    }
+    return decrypt(encryptedPassword);
+}
+
+    // ***********************************************************************
+    // * Function Name: dump                                                 *
+    // * Description: Outputs all user password pairs, holding every write   *
+    // *              lock so the output is one consistent image             *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void ConcurrentPassServer::dump() const {
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (const auto& shard : shards) {
+        locks.emplace_back(shard->writeLock);
+    }
+    for (const auto& shard : shards) {
+        shard->table.dump();
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: size                                                 *
+    // * Description: Returns the number of user password pairs              *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+size_t ConcurrentPassServer::size() const {
+    size_t total = 0;
+    for (const auto& shard : shards) {
+        total += shard->table.size();
+    }
+    return total;
+}
+
+    // ***********************************************************************
+    // * Function Name: write_to_file                                        *
+    // * Description: Writes all user-password pairs to one file. Writers    *
+    // *              are held off for the whole write so the file is a      *
+    // *              consistent image; readers keep running. The file is    *
+    // *              written to a temp file and renamed into place          *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* filename: The name of the file to write               *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool ConcurrentPassServer::write_to_file(const char* filename) const {
+    AtomicFile outfile;
+    if (!outfile.open(filename)) {
+        return false;
+    }
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (const auto& shard : shards) {
+        locks.emplace_back(shard->writeLock);
+    }
+    auto emit = [&outfile](const std::string& chunk) {
+        return outfile.write(chunk.data(), chunk.size());
+    };
+    for (const auto& shard : shards) {
+        if (!shard->table.writeText(emit)) {
+            return false;
+        }
+    }
+    return outfile.commit();
+}
+
+    // ***********************************************************************
+    // * Function Name: shardIndex                                           *
+    // * Description: Returns the index of the shard that owns a user. The   *
+    // *              hash is mixed first so the shard does not depend on    *
+    // *              the same low bits the shard's table uses for buckets   *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::string& user: The username                             *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+size_t ConcurrentPassServer::shardIndex(const std::string& user) const {
+    static std::hash<std::string> hf;
+    unsigned long long h = hf(user) * 0x9e3779b97f4a7c15ULL;
+    return static_cast<size_t>((h >> 32) % shards.size());
+}
+
+    // ***********************************************************************
+    // * Function Name: shardOf                                              *
+    // * Description: Returns the shard that owns a user                     *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::string& user: The username                             *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+ConcurrentPassServer::Shard& ConcurrentPassServer::shardOf(const std::string& user) const {
+    return *shards[shardIndex(user)];
+}
+
+    // ***********************************************************************
+    // * Function Name: encrypt                                              *
+    // * Description: Encrypts a string using base64 encoding                *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::string& str: string being encrypted                    *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+std::string ConcurrentPassServer::encrypt(const std::string& str) const {
+    std::string encoded;
+    encoded.resize(((str.size() + 2) / 3) * 4);
+
+    size_t encoded_len = base64_encode(reinterpret_cast<const BYTE*>(str.data()), reinterpret_cast<BYTE*>(&encoded[0]), str.size(), 0);
+
+    encoded.resize(encoded_len);
+    return encoded;
+}
+
+    // ***********************************************************************
+    // * Function Name: decrypt                                              *
+    // * Description: Decrypts an encoded string. The NUL encrypt leaves at  *
+    // *              the end of the encoding is dropped first, so it does   *
+    // *              not decode into a stray byte                           *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::string& str: The string to decrypt                     *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+std::string ConcurrentPassServer::decrypt(const std::string& str) const {
+    size_t length = str.size();
+    while (length > 0 && str[length - 1] == '\0') {
+        --length;
+    }
+    std::string decoded;
+    decoded.resize((length * 3) / 4);
+
+    size_t decoded_len = base64_decode(reinterpret_cast<const BYTE*>(str.data()), reinterpret_cast<BYTE*>(&decoded[0]), length);
+
+    decoded.resize(decoded_len);
+    return decoded;
+}
+
+}
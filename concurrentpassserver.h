@@ -0,0 +1,50 @@
+#ifndef CONCURRENTPASSSERVER_H
+#define CONCURRENTPASSSERVER_H
+
+#include "rcuhashtable.h"
+#include "base64.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+namespace cop4530 {
+
+// PassServer for many threads. Users are split across shards. find, match
+// and decodepw take no lock at all: each shard is an RcuHashTable read under
+// an EpochGuard. addUser, removeUser and changePassword lock only the write
+// mutex of the user's shard, so writers on different shards never meet and
+// readers never wait for any of them.
+class ConcurrentPassServer {
+public:
+    ConcurrentPassServer(size_t size = 101, size_t shards = 16);
+    ~ConcurrentPassServer();
+
+    bool load(const char* filename);
+    bool addUser(std::pair<std::string, std::string>& kv);
+    bool addUser(std::pair<std::string, std::string>&& kv);
+    bool removeUser(const std::string& k);
+    bool changePassword(const std::pair<std::string, std::string>& p, const std::string& newpassword);
+    bool find(const std::string& user) const;
+    bool match(const std::pair<std::string, std::string>& kv) const;
+    std::string decodepw(const std::string& user) const;
+    void dump() const;
+    size_t size() const;
+    bool write_to_file(const char* filename) const;
+
+private:
+    struct alignas(64) Shard {
+        explicit Shard(size_t size) : table(size) {}
+        mutable std::mutex writeLock;
+        RcuHashTable<std::string, std::string> table;
+    };
+    std::vector<std::unique_ptr<Shard>> shards;
+    size_t shardIndex(const std::string& user) const;
+    Shard& shardOf(const std::string& user) const;
+    std::string encrypt(const std::string& str) const;
+    std::string decrypt(const std::string& str) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,193 @@
+#ifndef CUCKOOFILTER_H
+#define CUCKOOFILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace cop4530 {
+
+// A cuckoo filter (Fan, Andersen, Kaminsky and Mitzenmacher, "Cuckoo Filter:
+// Practically Better Than Bloom", 2014) over the hash codes a table already
+// keeps for its entries, so asking it about a key costs no extra hashing.
+// may_contain() never answers false for a code that was added and not
+// erased; it answers true for a code that was not with a chance of about
+// 8 in 65536. Unlike a Bloom filter it supports erase(), which must only be
+// given codes that were added.
+//
+// Each bucket is one 64-bit word of four 16-bit fingerprints, 0 meaning
+// empty, and a code may live in one of two buckets, so a lookup reads two
+// words and a filter of n codes takes about 2.3 bytes each. A code that
+// cannot be placed after max_kicks evictions goes to a small stash, which
+// keeps the filter exact, and add() reports when the filter is past its
+// load limit and should be rebuilt larger.
+class CuckooFilter {
+public:
+    // an inactive filter that holds nothing and answers every query with true
+    CuckooFilter() : mask(0), count(0), kick(0) {}
+
+    // an empty filter with room for at least keys codes
+    explicit CuckooFilter(size_t keys) : mask(0), count(0), kick(0) {
+        size_t buckets = 1;
+        while (buckets * slots_per_bucket * max_load < keys) {
+            buckets *= 2;
+        }
+        table.assign(buckets, 0);
+        mask = buckets - 1;
+    }
+
+    bool active() const {
+        return !table.empty();
+    }
+
+    bool may_contain(uint64_t code) const {
+        if (table.empty()) {
+            return true;
+        }
+        uint64_t h = mix(code);
+        uint16_t fp = fingerprint(h);
+        size_t first = h & mask;
+        if (holds(table[first], fp) || holds(table[alternate(first, fp)], fp)) {
+            return true;
+        }
+        for (const auto& item : stash) {
+            if (item.second == fp && (item.first == first || item.first == alternate(first, fp))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Records code. Returns false once the filter holds more codes than its
+    // load limit, when the caller should rebuild it larger.
+    bool add(uint64_t code) {
+        uint64_t h = mix(code);
+        uint16_t fp = fingerprint(h);
+        size_t bucket = h & mask;
+        ++count;
+        if (place(bucket, fp) || place(alternate(bucket, fp), fp)) {
+            return count <= capacity();
+        }
+        // evict a resident fingerprint to its other bucket, and so on
+        for (size_t kicks = 0; kicks < max_kicks; ++kicks) {
+            size_t slot = kick++ % slots_per_bucket;
+            uint16_t evicted = lane(table[bucket], slot);
+            table[bucket] = (table[bucket] & ~(uint64_t(0xffff) << (16 * slot))) | (uint64_t(fp) << (16 * slot));
+            fp = evicted;
+            bucket = alternate(bucket, fp);
+            if (place(bucket, fp)) {
+                return count <= capacity();
+            }
+        }
+        stash.emplace_back(bucket, fp);
+        return count <= capacity();
+    }
+
+    void erase(uint64_t code) {
+        uint64_t h = mix(code);
+        uint16_t fp = fingerprint(h);
+        size_t first = h & mask;
+        if (remove(first, fp) || remove(alternate(first, fp), fp)) {
+            --count;
+            return;
+        }
+        for (size_t i = 0; i < stash.size(); ++i) {
+            if (stash[i].second == fp && (stash[i].first == first || stash[i].first == alternate(first, fp))) {
+                stash.erase(stash.begin() + i);
+                --count;
+                return;
+            }
+        }
+    }
+
+    // forgets every code but keeps the size
+    void clear() {
+        table.assign(table.size(), 0);
+        stash.clear();
+        count = 0;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    // the codes the filter holds before add() asks for a rebuild
+    size_t capacity() const {
+        return static_cast<size_t>(table.size() * slots_per_bucket * max_load);
+    }
+
+    size_t bytes() const {
+        return table.capacity() * sizeof(uint64_t) + stash.capacity() * sizeof(stash[0]);
+    }
+
+private:
+    static constexpr size_t slots_per_bucket = 4;
+    static constexpr double max_load = 0.9;
+    static constexpr size_t max_kicks = 500;
+    static constexpr uint64_t lanes_low = 0x0001000100010001ULL;
+    static constexpr uint64_t lanes_high = 0x8000800080008000ULL;
+
+    std::vector<uint64_t> table;
+    std::vector<std::pair<size_t, uint16_t>> stash; // bucket and fingerprint
+    size_t mask;
+    size_t count;
+    size_t kick; // picks the slot to evict, round robin
+
+    // spreads a code over all 64 bits (the MurmurHash3 finalizer), since some
+    // hashers, std::hash of an integer among them, return the key itself
+    static uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // the top 16 bits, which the bucket index does not use; 0 marks an empty slot
+    static uint16_t fingerprint(uint64_t h) {
+        uint16_t fp = static_cast<uint16_t>(h >> 48);
+        return fp ? fp : 1;
+    }
+
+    // the other bucket of a fingerprint; applied twice it returns the first
+    size_t alternate(size_t bucket, uint16_t fp) const {
+        return (bucket ^ (fp * 0x5bd1e995ULL)) & mask;
+    }
+
+    static uint16_t lane(uint64_t word, size_t slot) {
+        return static_cast<uint16_t>(word >> (16 * slot));
+    }
+
+    // true when any of the four fingerprints in word equals fp, tested for
+    // all four at once by looking for a zero lane in their xor with fp
+    static bool holds(uint64_t word, uint16_t fp) {
+        uint64_t x = word ^ (lanes_low * fp);
+        return ((x - lanes_low) & ~x & lanes_high) != 0;
+    }
+
+    bool place(size_t bucket, uint16_t fp) {
+        for (size_t slot = 0; slot < slots_per_bucket; ++slot) {
+            if (lane(table[bucket], slot) == 0) {
+                table[bucket] |= uint64_t(fp) << (16 * slot);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool remove(size_t bucket, uint16_t fp) {
+        for (size_t slot = 0; slot < slots_per_bucket; ++slot) {
+            if (lane(table[bucket], slot) == fp) {
+                table[bucket] &= ~(uint64_t(0xffff) << (16 * slot));
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+}
+
+#endif
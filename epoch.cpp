@@ -0,0 +1,216 @@
+#include "epoch.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+namespace cop4530 {
+
+namespace {
+
+// retirements between two automatic collection attempts
+const size_t collect_interval = 64;
+
+// One per thread that has ever entered a guard. epoch is 0 while the thread
+// is outside every guard, otherwise the global epoch it observed on entry.
+struct alignas(64) EpochRecord {
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<bool> inUse{true};
+    EpochRecord* next = nullptr;
+};
+
+struct Retired {
+    void* object;
+    void (*deleter)(void*);
+    uint64_t epoch;
+};
+
+class EpochDomain {
+public:
+    EpochDomain() : globalEpoch(1), records(nullptr), sinceCollect(0) {}
+
+    ~EpochDomain() {
+        for (auto& r : limbo) {
+            r.deleter(r.object);
+        }
+        EpochRecord* rec = records.load();
+        while (rec) {
+            EpochRecord* next = rec->next;
+            delete rec;
+            rec = next;
+        }
+    }
+
+    // reuses the record of an exited thread when there is one
+    EpochRecord* acquire() {
+        for (EpochRecord* rec = records.load(std::memory_order_acquire); rec; rec = rec->next) {
+            bool expected = false;
+            if (!rec->inUse.load(std::memory_order_relaxed) &&
+                rec->inUse.compare_exchange_strong(expected, true)) {
+                return rec;
+            }
+        }
+        EpochRecord* rec = new EpochRecord;
+        rec->next = records.load(std::memory_order_relaxed);
+        while (!records.compare_exchange_weak(rec->next, rec, std::memory_order_release)) {
+        }
+        return rec;
+    }
+
+    void enter(EpochRecord* rec) {
+        rec->epoch.store(globalEpoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        // the pinned epoch must be visible before any shared pointer is read
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    void leave(EpochRecord* rec) {
+        rec->epoch.store(0, std::memory_order_release);
+    }
+
+    void retire(void* object, void (*deleter)(void*)) {
+        bool collectNow;
+        {
+            std::lock_guard<std::mutex> guard(limboLock);
+            limbo.push_back({object, deleter, globalEpoch.load(std::memory_order_relaxed)});
+            collectNow = ++sinceCollect >= collect_interval;
+        }
+        if (collectNow) {
+            collect();
+        }
+    }
+
+    // An object retired in epoch e may still be seen by readers pinned at e,
+    // so it is freed once the global epoch reaches e + 2.
+    void collect() {
+        std::vector<Retired> ready;
+        {
+            std::lock_guard<std::mutex> guard(limboLock);
+            sinceCollect = 0;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            uint64_t current = globalEpoch.load(std::memory_order_relaxed);
+            bool quiescent = true;
+            for (EpochRecord* rec = records.load(std::memory_order_acquire); rec; rec = rec->next) {
+                uint64_t pinned = rec->epoch.load(std::memory_order_acquire);
+                if (pinned != 0 && pinned != current) {
+                    quiescent = false;
+                    break;
+                }
+            }
+            if (quiescent) {
+                globalEpoch.store(++current, std::memory_order_seq_cst);
+            }
+            size_t kept = 0;
+            for (auto& r : limbo) {
+                if (r.epoch + 2 <= current) {
+                    ready.push_back(r);
+                } else {
+                    limbo[kept++] = r;
+                }
+            }
+            limbo.resize(kept);
+        }
+        for (auto& r : ready) {
+            r.deleter(r.object);
+        }
+    }
+
+private:
+    std::atomic<uint64_t> globalEpoch;
+    std::atomic<EpochRecord*> records;
+    std::mutex limboLock;
+    std::vector<Retired> limbo;
+    size_t sinceCollect;
+};
+
+EpochDomain& domain() {
+    static EpochDomain instance;
+    return instance;
+}
+
+// the calling thread's record, released for reuse when the thread exits
+struct ThreadRecord {
+    EpochRecord* rec = nullptr;
+    unsigned depth = 0;
+    ~ThreadRecord() {
+        if (rec) {
+            rec->epoch.store(0, std::memory_order_release);
+            rec->inUse.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadRecord threadRecord;
+
+}
+
+    // ***********************************************************************
+    // * Function Name: EpochGuard                                           *
+    // * Description: Pins the current epoch for the calling thread. Guards  *
+    // *              nest; only the outermost one pins and unpins           *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+EpochGuard::EpochGuard() {
+    ThreadRecord& self = threadRecord;
+    if (self.depth++ == 0) {
+        if (!self.rec) {
+            self.rec = domain().acquire();
+        }
+        domain().enter(self.rec);
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: ~EpochGuard                                          *
+    // * Description: Unpins the calling thread when the outermost guard     *
+    // *              ends                                                   *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+EpochGuard::~EpochGuard() {
+    ThreadRecord& self = threadRecord;
+    if (--self.depth == 0) {
+        domain().leave(self.rec);
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: epoch_retire                                         *
+    // * Description: Queues an unlinked object for deletion once no reader *
+    // *              can still reach it                                     *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - void* p: The object to free                                       *
+    // * - void (*deleter)(void*): Frees p                                   *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void epoch_retire(void* p, void (*deleter)(void*)) {
+    domain().retire(p, deleter);
+}
+
+    // ***********************************************************************
+    // * Function Name: epoch_collect                                        *
+    // * Description: Advances the epoch when possible and frees retired    *
+    // *              objects that are no longer reachable                   *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void epoch_collect() {
+    domain().collect();
+}
+
+}
@@ -0,0 +1,35 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <cstddef>
+
+namespace cop4530 {
+
+// Epoch-based reclamation for lock-free readers. A reader holds an
+// EpochGuard while it follows shared pointers. A writer that unlinks an
+// object passes it to epoch_retire() instead of deleting it, and the object
+// is freed only after every guard that might still reference it has ended.
+// Readers never block and never take a lock.
+class EpochGuard {
+public:
+    EpochGuard();
+    ~EpochGuard();
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+// Hands p to the reclaimer; deleter(p) runs once no reader can reach it.
+void epoch_retire(void* p, void (*deleter)(void*));
+
+// Advances the global epoch if every active reader has caught up and frees
+// whatever has become unreachable. Retiring calls this periodically.
+void epoch_collect();
+
+template <typename T>
+void epoch_retire(T* p) {
+    epoch_retire(static_cast<void*>(p), [](void* q) { delete static_cast<T*>(q); });
+}
+
+}
+
+#endif
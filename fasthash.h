@@ -0,0 +1,126 @@
+#ifndef FASTHASH_H
+#define FASTHASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace cop4530 {
+
+namespace detail {
+
+// 64 x 64 -> 128 bit multiply, returning the low half in a and the high half in b
+inline void wymum(uint64_t& a, uint64_t& b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    a = static_cast<uint64_t>(r);
+    b = static_cast<uint64_t>(r >> 64);
+#else
+    uint64_t ha = a >> 32, hb = b >> 32, la = static_cast<uint32_t>(a), lb = static_cast<uint32_t>(b);
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    a = lo;
+    b = hi;
+#endif
+}
+
+inline uint64_t wymix(uint64_t a, uint64_t b) {
+    wymum(a, b);
+    return a ^ b;
+}
+
+inline uint64_t wyread8(const unsigned char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+}
+
+inline uint64_t wyread4(const unsigned char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+// the first, middle and last byte of a 1 to 3 byte key
+inline uint64_t wyread3(const unsigned char* p, size_t k) {
+    return (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[k >> 1]) << 8) | p[k - 1];
+}
+
+static const uint64_t wysecret[4] = {0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+                                     0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL};
+
+} // namespace detail
+
+// Hashes n bytes with wyhash (final version 4). Keys of up to 16 bytes, which
+// is nearly every username, take two overlapping loads and two multiplies;
+// longer keys are consumed 48 bytes per round in three independent lanes.
+// It passes SMHasher, unlike std::hash on common standard libraries, which is
+// no faster and mixes poorly.
+inline uint64_t hash_bytes(const void* data, size_t n, uint64_t seed = 0) {
+    using namespace detail;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    seed ^= wymix(seed ^ wysecret[0], wysecret[1]);
+    uint64_t a, b;
+    if (n <= 16) {
+        if (n >= 4) {
+            a = (wyread4(p) << 32) | wyread4(p + ((n >> 3) << 2));
+            b = (wyread4(p + n - 4) << 32) | wyread4(p + n - 4 - ((n >> 3) << 2));
+        } else if (n > 0) {
+            a = wyread3(p, n);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = n;
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wymix(wyread8(p) ^ wysecret[1], wyread8(p + 8) ^ seed);
+                see1 = wymix(wyread8(p + 16) ^ wysecret[2], wyread8(p + 24) ^ see1);
+                see2 = wymix(wyread8(p + 32) ^ wysecret[3], wyread8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wymix(wyread8(p) ^ wysecret[1], wyread8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wyread8(p + i - 16);
+        b = wyread8(p + i - 8);
+    }
+    a ^= wysecret[1];
+    b ^= seed;
+    wymum(a, b);
+    return wymix(a ^ wysecret[0] ^ n, b ^ wysecret[1]);
+}
+
+// Hasher for the Hash parameter of HashTable. Strings and string views are
+// hashed with hash_bytes, through a string_view so that a table of strings
+// can look up a view without building a string; any other key type falls
+// back to std::hash.
+template <typename K>
+struct fast_hash : std::hash<K> {};
+
+template <>
+struct fast_hash<std::string> {
+    size_t operator()(std::string_view s) const noexcept {
+        return static_cast<size_t>(hash_bytes(s.data(), s.size()));
+    }
+};
+
+template <>
+struct fast_hash<std::string_view> : fast_hash<std::string> {};
+
+}
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef FLATHASHTABLE_H
+#define FLATHASHTABLE_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <utility>
+#include "hashtable.h"
+
+namespace cop4530 {
+
+namespace detail {
+
+// Control byte values of the flat table. A full slot stores the low 7 bits of
+// its key's hash, so every control byte with the high bit clear is full.
+static const int8_t ctrl_empty = -128;
+static const int8_t ctrl_deleted = -2;
+static const size_t group_width = 16;
+
+// 16 control bytes loaded at once; each match returns a bitmask with bit i
+// set when slot i of the group satisfies the test.
+class ProbeGroup {
+public:
+    explicit ProbeGroup(const int8_t* ctrl);
+    uint32_t match(int8_t h2) const;
+    uint32_t match_empty() const;
+    uint32_t match_empty_or_deleted() const;
+
+private:
+    const int8_t* bytes;
+};
+
+} // namespace detail
+
+template <typename K, typename V, typename Alloc, typename Hash>
+class HashTable<K, V, open_addressing, Alloc, Hash> {
+public:
+    explicit HashTable(size_t size = 101, const Alloc& alloc = Alloc());
+    ~HashTable();
+    bool contains(const K& k) const;
+    bool match(const std::pair<K, V>& kv) const;
+    bool insert(const std::pair<K, V>& kv);
+    bool insert(std::pair<K, V>&& kv);
+    std::vector<bool> contains_many(const std::vector<K>& keys) const;
+    std::vector<bool> match_many(const std::vector<std::pair<K, V>>& kvs) const;
+    std::vector<bool> insert_many(const std::vector<std::pair<K, V>>& kvs);
+    bool remove(const K& k);
+    template <typename Q, typename = detail::enable_view_lookup<K, Q>>
+    bool contains(const Q& k) const;
+    template <typename Q, typename = detail::enable_view_lookup<K, Q>>
+    bool remove(const Q& k);
+    void clear();
+    std::string getpassword(std::string_view user) const;
+    bool load(const char* filename);
+    void dump() const;
+    bool write(const char* filename) const;
+    bool write(std::ostream& out) const;
+    bool write_snapshot(const char* filename) const;
+    bool load_snapshot(const char* filename);
+    size_t size() const;
+    void set_value_storage(value_storage mode);
+    TableStats stats() const;
+    void reserve(size_t n);
+    bool set_max_load_factor(double factor);
+    bool set_growth_factor(double factor);
+
+private:
+    typedef detail::HashedEntry<K, V> Entry; // the hash is myhash(key), mixed
+    typedef typename std::allocator_traits<Alloc>::template rebind_alloc<Entry> EntryAlloc;
+    std::vector<int8_t> ctrl;
+    std::vector<Entry, EntryAlloc> slots;
+    Hash hasher;
+    size_t currentSize;
+    size_t deletedCount;
+    value_storage storage;
+    detail::TableCounters counters;
+    double maxLoad;
+    double growth;
+    void makeEmpty();
+    void makeRoom(size_t extra);
+    void rehash(size_t newCapacity);
+    template <typename Q>
+    size_t find(const Q& k, size_t hash) const;
+    void prefetchGroup(size_t hash) const;
+    size_t prepareInsert(size_t hash);
+    void insertEncoded(std::pair<K, V>&& kv);
+    template <typename Emit>
+    bool writeText(Emit emit) const;
+    size_t myhash(const K& k) const;
+    static size_t mix(size_t code);
+    uint64_t fingerprint() const;
+    void erase(size_t index);
+    size_t capacityFor(size_t n) const;
+    size_t probeLength(size_t index) const;
+    V toStored(V value) const;
+    void appendEncoded(std::string& out, const std::string& value) const;
+    std::string decryptExact(std::string_view str) const;
+    std::string encrypt(const std::string& str) const;
+    std::string decrypt(const std::string& str) const;
+};
+
+}
+#include "flathashtable.hpp"
+
+#endif
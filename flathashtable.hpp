@@ -0,0 +1,1201 @@
+#ifndef FLATHASHTABLE_HPP
+#define FLATHASHTABLE_HPP
+
+#include "flathashtable.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace cop4530 {
+
+namespace detail {
+
+// index of the lowest set bit of a non-zero probe mask
+inline unsigned lowest_bit(uint32_t mask) {
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+    unsigned i = 0;
+    while (!(mask & 1u)) {
+        mask >>= 1;
+        ++i;
+    }
+    return i;
+#endif
+}
+
+inline ProbeGroup::ProbeGroup(const int8_t* ctrl) : bytes(ctrl) {}
+
+inline uint32_t ProbeGroup::match(int8_t h2) const {
+#if defined(__SSE2__)
+    __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(h2))));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < group_width; ++i) {
+        if (bytes[i] == h2) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+inline uint32_t ProbeGroup::match_empty() const {
+    return match(ctrl_empty);
+}
+
+inline uint32_t ProbeGroup::match_empty_or_deleted() const {
+#if defined(__SSE2__)
+    // empty (-128) and deleted (-2) are the only control bytes below -1
+    __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), group)));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < group_width; ++i) {
+        if (bytes[i] < -1) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+} // namespace detail
+
+    // ***********************************************************************
+    // * Function Name: HashTable                                            *
+    // * Description: Constructor for the open addressing HashTable, sizes   *
+    // *              the slot array to hold at least size entries           *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t size: number of entries to make room for                   *
+    // * - const Alloc& alloc: allocator for the slot array                  *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+HashTable<K, V, open_addressing, Alloc, Hash>::HashTable(size_t size, const Alloc& alloc)
+    : slots(alloc), currentSize(0), deletedCount(0), storage(value_storage::encoded),
+      maxLoad(flat_max_load_factor), growth(default_growth_factor) {
+    if (size < 1) {
+        size = 101;
+    }
+    size_t capacity = capacityFor(size);
+    ctrl.assign(capacity, detail::ctrl_empty);
+    slots.resize(capacity);
+}
+
+    // ***********************************************************************
+    // * Function Name: ~HashTable                                           *
+    // * Description: Destructor, clears the hash table                      *
+    // *                                                                     *
+    // * Parameter Description: none                                         *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+HashTable<K, V, open_addressing, Alloc, Hash>::~HashTable() {
+    clear();
+}
+
+    // ***********************************************************************
+    // * Function Name: contains                                             *
+    // * Description: Checks if a key is in the hash table                   *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const K& k: The key to check for in the hash table                *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+bool HashTable<K, V, open_addressing, Alloc, Hash>::contains(const K& k) const {
+    bool found = find(k, myhash(k)) != slots.size();
+    counters.lookups.count(found);
+    return found;
+}
+
+    // ***********************************************************************
+    // * Function Name: match                                                *
+    // * Description: Checks if a given key value pair is in the table       *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::pair<K, V>& kv: The key value pair to check for        *
+    // *                              presence in the hash table             *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+bool HashTable<K, V, open_addressing, Alloc, Hash>::match(const std::pair<K, V>& kv) const {
+    size_t index = find(kv.first, myhash(kv.first));
+    bool matched = index != slots.size() &&
+                   (storage == value_storage::raw ? slots[index].second == kv.second
+                                                  : slots[index].second == encrypt(kv.second));
+    counters.matches.count(matched);
+    return matched;
+}
+
+    // ***********************************************************************
+    // * Function Name: insert                                               *
+    // * Description: Inserts a key value pair into the hash table           *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::pair<K, V>& kv: The key value pair to insert           *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+bool HashTable<K, V, open_addressing, Alloc, Hash>::insert(const std::pair<K, V>& kv) {
+    return insert(std::pair<K, V>(kv));
+}
+
+    // ***********************************************************************
+    // * Function Name: insert                                               *
+    // * Description: Inserts a key value pair using move semantics.         *
+    // *              Fails if key exists                                    *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::pair<K, V>&& kv: The key-value pair to insert                *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+bool HashTable<K, V, open_addressing, Alloc, Hash>::insert(std::pair<K, V>&& kv) {
+    size_t hash = myhash(kv.first);
+    if (find(kv.first, hash) != slots.size()) {
+        counters.inserts.count(false);
+        return false;
+    }
+    makeRoom(1);
+    size_t index = prepareInsert(hash);
+    if (ctrl[index] == detail::ctrl_deleted) {
+        --deletedCount;
+    }
+    ctrl[index] = static_cast<int8_t>(hash & 0x7F);
+    slots[index].first = std::move(kv.first);
+    slots[index].second = toStored(std::move(kv.second));
+    slots[index].hash = hash;
+    ++currentSize;
+    counters.inserts.count(true);
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: contains_many                                        *
+    // * Description: Checks a batch of keys. Each window of batch_window    *
+    // *              keys is hashed and the first probe group of every key  *
+    // *              prefetched before any of them is probed, so the cache  *
+    // *              misses of the window overlap                           *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::vector<K>& keys: The keys to look for                  *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+std::vector<bool> HashTable<K, V, open_addressing, Alloc, Hash>::contains_many(const std::vector<K>& keys) const {
+    std::vector<bool> found(keys.size(), false);
+    size_t hashes[batch_window];
+    for (size_t start = 0; start < keys.size(); start += batch_window) {
+        size_t count = std::min<size_t>(batch_window, keys.size() - start);
+        for (size_t i = 0; i < count; ++i) {
+            hashes[i] = myhash(keys[start + i]);
+            prefetchGroup(hashes[i]);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            found[start + i] = find(keys[start + i], hashes[i]) != slots.size();
+            counters.lookups.count(found[start + i]);
+        }
+    }
+    return found;
+}
+
+    // ***********************************************************************
+    // * Function Name: match_many                                           *
+    // * Description: Checks a batch of key value pairs the same way as      *
+    // *              contains_many. The values are encrypted while the      *
+    // *              group prefetches are in flight                         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::vector<std::pair<K, V>>& kvs: The pairs to check for   *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+std::vector<bool> HashTable<K, V, open_addressing, Alloc, Hash>::match_many(const std::vector<std::pair<K, V>>& kvs) const {
+    std::vector<bool> matched(kvs.size(), false);
+    size_t hashes[batch_window];
+    std::string encrypted[batch_window];
+    const V* wanted[batch_window];
+    bool raw = storage == value_storage::raw;
+    for (size_t start = 0; start < kvs.size(); start += batch_window) {
+        size_t count = std::min<size_t>(batch_window, kvs.size() - start);
+        for (size_t i = 0; i < count; ++i) {
+            hashes[i] = myhash(kvs[start + i].first);
+            prefetchGroup(hashes[i]);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (raw) {
+                wanted[i] = &kvs[start + i].second;
+            } else {
+                encrypted[i] = encrypt(kvs[start + i].second);
+                wanted[i] = &encrypted[i];
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            size_t index = find(kvs[start + i].first, hashes[i]);
+            matched[start + i] = index != slots.size() && slots[index].second == *wanted[i];
+            counters.matches.count(matched[start + i]);
+        }
+    }
+    return matched;
+}
+
+    // ***********************************************************************
+    // * Function Name: insert_many                                          *
+    // * Description: Inserts a batch of key value pairs, prefetching the    *
+    // *              first probe group of each window before its inserts    *
+    // *              run. Grows the table once up front when the batch      *
+    // *              would cross the load limit                             *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::vector<std::pair<K, V>>& kvs: The pairs to insert      *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+std::vector<bool> HashTable<K, V, open_addressing, Alloc, Hash>::insert_many(const std::vector<std::pair<K, V>>& kvs) {
+    std::vector<bool> inserted(kvs.size(), false);
+    makeRoom(kvs.size());
+    for (size_t start = 0; start < kvs.size(); start += batch_window) {
+        size_t count = std::min<size_t>(batch_window, kvs.size() - start);
+        for (size_t i = 0; i < count; ++i) {
+            prefetchGroup(myhash(kvs[start + i].first));
+        }
+        for (size_t i = 0; i < count; ++i) {
+            inserted[start + i] = insert(kvs[start + i]);
+        }
+    }
+    return inserted;
+}
+
+    // ***********************************************************************
+    // * Function Name: remove                                               *
+    // * Description: Removes a key value pair from the hash table. The slot *
+    // *              becomes empty again when its group was never full,     *
+    // *              otherwise it is marked deleted to keep probes intact   *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const K& k: The key to remove                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+bool HashTable<K, V, open_addressing, Alloc, Hash>::remove(const K& k) {
+    size_t index = find(k, myhash(k));
+    counters.removes.count(index != slots.size());
+    if (index == slots.size()) {
+        return false;
+    }
+    erase(index);
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: contains                                             *
+    // * Description: Checks if a key is in the hash table without building *
+    // *              a std::string from it                                  *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const Q& k: A string view, C string or literal naming the key     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+template <typename Q, typename>
+bool HashTable<K, V, open_addressing, Alloc, Hash>::contains(const Q& k) const {
+    std::string_view key(k);
+    bool found = find(key, mix(detail::hash_view(hasher, key))) != slots.size();
+    counters.lookups.count(found);
+    return found;
+}
+
+    // ***********************************************************************
+    // * Function Name: remove                                               *
+    // * Description: Removes a key value pair from the hash table without   *
+    // *              building a std::string from the key                    *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const Q& k: A string view, C string or literal naming the key     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+template <typename Q, typename>
+bool HashTable<K, V, open_addressing, Alloc, Hash>::remove(const Q& k) {
+    std::string_view key(k);
+    size_t index = find(key, mix(detail::hash_view(hasher, key)));
+    counters.removes.count(index != slots.size());
+    if (index == slots.size()) {
+        return false;
+    }
+    erase(index);
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: clear                                                *
+    // * Description: Clears the hash table by removing all key-value pairs. *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+void HashTable<K, V, open_addressing, Alloc, Hash>::clear() {
+    makeEmpty();
+}
+
+    // ***********************************************************************
+    // * Function Name: getpassword                                          *
+    // * Description: Retrieves the password for a user                      *
+    // * Parameter Description:                                              *
+    // * - std::string_view user: The username to look up.                   *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+std::string HashTable<K, V, open_addressing, Alloc, Hash>::getpassword(std::string_view user) const {
+    size_t index = find(user, mix(detail::hash_view(hasher, user)));
+    counters.lookups.count(index != slots.size());
+    if (index == slots.size()) {
+        return "NOT FOUND";
+    }
+    if (storage == value_storage::raw) {
+        return slots[index].second;
+    }
+    return decrypt(slots[index].second);
+}
+
+    // ***********************************************************************
+    // * Function Name: load                                                 *
+    // * Description: Loads key-value pairs from file into the hash table    *
+    // *              Clears the current table before loading. String        *
+    // *              tables map the file and build entries straight from    *
+    // *              the mapped bytes, after sizing the table for the       *
+    // *              file's lines so the load rehashes at most once;        *
+    // *              malformed lines are reported and skipped               *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* filename: The name of the file to load from           *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+bool HashTable<K, V, open_addressing, Alloc, Hash>::load(const char* filename) {
+    if constexpr (std::is_same<K, std::string>::value && std::is_same<V, std::string>::value) {
+        MappedFile file(filename);
+        if (!file.is_open()) {
+            return false;
+        }
+        clear();
+        reserve(count_lines(file));
+        for_each_pair(file, filename, [this](std::string_view key, std::string_view value) {
+            insert(std::pair<K, V>(std::string(key), std::string(value)));
+        });
+        return true;
+    } else {
+        K key;
+        V value;
+        std::ifstream infile(filename);
+        if (!infile) {
+            return false;
+        }
+        clear();
+        while (infile >> key >> value) {
+            insert({key, value});
+        }
+        infile.close();
+        return true;
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: dump                                                 *
+    // * Description: Outputs all key value pairs in the hash table          *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+void HashTable<K, V, open_addressing, Alloc, Hash>::dump() const {
+    write(std::cout);
+}
+
+    // ***********************************************************************
+    // * Function Name: write                                                *
+    // * Description: Writes all key value pairs in the hash table to a file *
+    // *              through a temp file that is fsynced and renamed over   *
+    // *              it, so a crash never leaves a partial file behind      *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* filename: The name of the file to write               *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+bool HashTable<K, V, open_addressing, Alloc, Hash>::write(const char* filename) const {
+    AtomicFile outfile;
+    if (!outfile.open(filename)) {
+        return false;
+    }
+    bool written = writeText([&outfile](const std::string& chunk) {
+        return outfile.write(chunk.data(), chunk.size());
+    });
+
+    return written && outfile.commit();
+}
+
+    // ***********************************************************************
+    // * Function Name: write                                                *
+    // * Description: Writes all key value pairs in the hash table to an     *
+    // *              open stream, one pair per line                         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::ostream& out: The stream to write to                         *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+bool HashTable<K, V, open_addressing, Alloc, Hash>::write(std::ostream& out) const {
+    writeText([&out](const std::string& chunk) {
+        out.write(chunk.data(), chunk.size());
+        return static_cast<bool>(out);
+    });
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+    // ***********************************************************************
+    // * Function Name: writeText                                            *
+    // * Description: Formats every full slot as a "key value" line and      *
+    // *              passes the text to emit a chunk at a time. Slot ranges *
+    // *              are formatted on several threads and the chunks        *
+    // *              arrive in slot order                                   *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - Emit emit: Called with each chunk, returns false to stop          *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+template <typename Emit>
+bool HashTable<K, V, open_addressing, Alloc, Hash>::writeText(Emit emit) const {
+    auto format = [this](size_t begin, size_t end, std::string& chunk) {
+        for (size_t i = begin; i < end; ++i) {
+            if (ctrl[i] >= 0) {
+                detail::append_text(chunk, slots[i].first);
+                chunk += ' ';
+                if (storage == value_storage::raw) {
+                    appendEncoded(chunk, slots[i].second);
+                } else {
+                    detail::append_text(chunk, slots[i].second);
+                }
+                chunk += '\n';
+            }
+        }
+    };
+    return detail::format_chunks(slots.size(), format, emit);
+}
+
+    // ***********************************************************************
+    // * Function Name: write_snapshot                                       *
+    // * Description: Writes the table as a binary snapshot: the control     *
+    // *              bytes followed by every pair with its slot index and   *
+    // *              the encoded value. A raw table encodes each value as   *
+    // *              it goes, so snapshots load into either mode            *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* filename: The name of the file to write               *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+bool HashTable<K, V, open_addressing, Alloc, Hash>::write_snapshot(const char* filename) const {
+    static_assert(std::is_same<K, std::string>::value && std::is_same<V, std::string>::value,
+                  "snapshots hold string keys and values");
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) {
+        return false;
+    }
+    SnapshotWriter writer(out, snapshot_open_addressing, slots.size(), currentSize, fingerprint());
+    writer.block(ctrl.data(), ctrl.size());
+    std::string encoded;
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (ctrl[i] < 0) {
+            continue;
+        }
+        if (storage == value_storage::raw) {
+            encoded.clear();
+            appendEncoded(encoded, slots[i].second);
+            writer.record(i, slots[i].first, encoded);
+        } else {
+            writer.record(i, slots[i].first, slots[i].second);
+        }
+    }
+    return writer.finish();
+}
+
+    // ***********************************************************************
+    // * Function Name: load_snapshot                                        *
+    // * Description: Replaces the table with the contents of a snapshot.    *
+    // *              An open addressing snapshot taken with the same        *
+    // *              hasher gets its control bytes copied back and each     *
+    // *              pair placed in its saved slot, with no probing or      *
+    // *              encoding; any other snapshot is re-hashed.             *
+    // *              A file that fails the header or checksum check leaves  *
+    // *              the table unchanged; records that disagree with their  *
+    // *              header leave it empty                                  *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* filename: The name of the file to load from           *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+bool HashTable<K, V, open_addressing, Alloc, Hash>::load_snapshot(const char* filename) {
+    static_assert(std::is_same<K, std::string>::value && std::is_same<V, std::string>::value,
+                  "snapshots hold string keys and values");
+    SnapshotReader reader;
+    if (!reader.open(filename)) {
+        return false;
+    }
+    const SnapshotHeader& head = reader.header();
+    const char* savedCtrl = nullptr;
+    if (head.layout == snapshot_open_addressing) {
+        savedCtrl = reader.block(head.buckets);
+        if (!savedCtrl) {
+            return false;
+        }
+    }
+    size_t capacity = head.buckets;
+    bool direct = savedCtrl && reader.same_hash(fingerprint()) && capacity >= detail::group_width &&
+                  (capacity & (capacity - 1)) == 0;
+    clear();
+    if (direct) {
+        ctrl.assign(savedCtrl, savedCtrl + capacity);
+        slots.clear();
+        slots.resize(capacity);
+        deletedCount = std::count(ctrl.begin(), ctrl.end(), detail::ctrl_deleted);
+    } else {
+        rehash(capacityFor(head.records));
+    }
+    uint64_t position;
+    std::string_view key, value;
+    bool raw = storage == value_storage::raw;
+    while (reader.next(position, key, value)) {
+        if (!direct) {
+            insertEncoded({std::string(key), raw ? decryptExact(value) : std::string(value)});
+        } else if (position < capacity && ctrl[position] >= 0) {
+            std::string k(key);
+            size_t hash = myhash(k);
+            slots[position] = Entry(hash, std::move(k), raw ? decryptExact(value) : std::string(value));
+            ++currentSize;
+        } else {
+            break;
+        }
+    }
+    size_t full = direct ? std::count_if(ctrl.begin(), ctrl.end(), [](int8_t c) { return c >= 0; }) : currentSize;
+    if (currentSize != head.records || full != currentSize) {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: size                                                 *
+    // * Description: Returns the number of key value pairs in the hash table*
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+size_t HashTable<K, V, open_addressing, Alloc, Hash>::size() const {
+    return currentSize;
+}
+
+    // ***********************************************************************
+    // * Function Name: set_value_storage                                    *
+    // * Description: Switches between encoded and raw values, converting    *
+    // *              every value already in the table                       *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - value_storage mode: value_storage::encoded or raw                 *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+void HashTable<K, V, open_addressing, Alloc, Hash>::set_value_storage(value_storage mode) {
+    if (mode == storage) {
+        return;
+    }
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (ctrl[i] >= 0) {
+            slots[i].second = mode == value_storage::raw ? decryptExact(slots[i].second) : encrypt(slots[i].second);
+        }
+    }
+    storage = mode;
+}
+
+    // ***********************************************************************
+    // * Function Name: stats                                                *
+    // * Description: Reports the table's shape, its rehash history and how  *
+    // *              often its operations found their keys. The histogram   *
+    // *              counts entries by the probe groups a lookup of them    *
+    // *              visits, measured by walking the slots when stats() is  *
+    // *              called                                                 *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+TableStats HashTable<K, V, open_addressing, Alloc, Hash>::stats() const {
+    TableStats stats;
+    counters.report(stats);
+    stats.size = currentSize;
+    stats.buckets = slots.size();
+    stats.load_factor = static_cast<double>(currentSize) / slots.size();
+    stats.bytes = ctrl.capacity() + slots.capacity() * sizeof(Entry);
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (ctrl[i] >= 0) {
+            size_t probes = probeLength(i);
+            detail::add_to_histogram(stats.chain_lengths, probes);
+            stats.max_probe = std::max(stats.max_probe, probes);
+            stats.bytes += detail::heap_bytes(slots[i].first) + detail::heap_bytes(slots[i].second);
+        }
+    }
+    return stats;
+}
+
+    // ***********************************************************************
+    // * Function Name: reserve                                              *
+    // * Description: Makes room for n entries with a single rehash          *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t n: The number of entries to make room for                  *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+void HashTable<K, V, open_addressing, Alloc, Hash>::reserve(size_t n) {
+    size_t capacity = capacityFor(n);
+    if (capacity > slots.size()) {
+        rehash(capacity);
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: set_max_load_factor                                  *
+    // * Description: Sets the share of slots that may be full or deleted    *
+    // *              before the table grows, and rehashes now if more are.  *
+    // *              Returns false and leaves the table alone unless the    *
+    // *              factor is positive and at most flat_max_load_factor    *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - double factor: Share of slots in use                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+bool HashTable<K, V, open_addressing, Alloc, Hash>::set_max_load_factor(double factor) {
+    if (!(factor > 0 && factor <= flat_max_load_factor)) {
+        std::cerr << "** max load factor must be above 0 and at most " << flat_max_load_factor << "\n";
+        return false;
+    }
+    maxLoad = factor;
+    makeRoom(0);
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: set_growth_factor                                    *
+    // * Description: Sets how many times larger the table becomes each time *
+    // *              it grows, rounded up to a power of two. Returns false  *
+    // *              and leaves the table alone for a factor that is not    *
+    // *              above 1                                                *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - double factor: The growth factor                                  *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+bool HashTable<K, V, open_addressing, Alloc, Hash>::set_growth_factor(double factor) {
+    if (!(factor > 1)) {
+        std::cerr << "** growth factor must be above 1\n";
+        return false;
+    }
+    growth = factor;
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: makeEmpty                                            *
+    // * Description: Clears all key value pairs from hash table             *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+void HashTable<K, V, open_addressing, Alloc, Hash>::makeEmpty() {
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (ctrl[i] >= 0) {
+            slots[i] = Entry();
+        }
+        ctrl[i] = detail::ctrl_empty;
+    }
+    currentSize = 0;
+    deletedCount = 0;
+}
+
+    // ***********************************************************************
+    // * Function Name: rehash                                               *
+    // * Description: Moves every entry into a fresh slot array of the given *
+    // *              capacity, dropping all deleted markers. Entries are    *
+    // *              placed by their stored hash, so no key is hashed again *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t newCapacity: slot count of the new array, a power of two   *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+void HashTable<K, V, open_addressing, Alloc, Hash>::rehash(size_t newCapacity) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<int8_t> oldCtrl;
+    std::vector<Entry, EntryAlloc> oldSlots(slots.get_allocator());
+    oldCtrl.swap(ctrl);
+    oldSlots.swap(slots);
+    ctrl.assign(newCapacity, detail::ctrl_empty);
+    slots.resize(newCapacity);
+    deletedCount = 0;
+
+    for (size_t i = 0; i < oldSlots.size(); ++i) {
+        if (oldCtrl[i] >= 0) {
+            size_t hash = oldSlots[i].hash;
+            size_t index = prepareInsert(hash);
+            ctrl[index] = static_cast<int8_t>(hash & 0x7F);
+            slots[index] = std::move(oldSlots[i]);
+        }
+    }
+    ++counters.rehashes;
+    counters.rehashNanos += detail::nanos_since(start);
+}
+
+    // ***********************************************************************
+    // * Function Name: find                                                 *
+    // * Description: Probes the groups of k's sequence 16 control bytes at  *
+    // *              a time. Returns the slot index of k, or slots.size()   *
+    // *              once a group with an empty slot ends the sequence      *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const Q& k: The key to look for, a K or a view of one             *
+    // * - size_t hash: myhash(k)                                            *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+template <typename Q>
+size_t HashTable<K, V, open_addressing, Alloc, Hash>::find(const Q& k, size_t hash) const {
+    size_t groupMask = slots.size() / detail::group_width - 1;
+    size_t group = (hash >> 7) & groupMask;
+    int8_t h2 = static_cast<int8_t>(hash & 0x7F);
+    for (size_t step = 1; step <= groupMask + 1; ++step) {
+        size_t base = group * detail::group_width;
+        detail::ProbeGroup probe(&ctrl[base]);
+        for (uint32_t candidates = probe.match(h2); candidates; candidates &= candidates - 1) {
+            size_t index = base + detail::lowest_bit(candidates);
+            if (slots[index].hash == hash && slots[index].first == k) {
+                return index;
+            }
+        }
+        if (probe.match_empty()) {
+            break;
+        }
+        group = (group + step) & groupMask;
+    }
+    return slots.size();
+}
+
+    // ***********************************************************************
+    // * Function Name: prefetchGroup                                        *
+    // * Description: Starts loading the control bytes and slots of the     *
+    // *              first group on hash's probe sequence                   *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t hash: myhash of the key about to be probed                 *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+void HashTable<K, V, open_addressing, Alloc, Hash>::prefetchGroup(size_t hash) const {
+    size_t groupMask = slots.size() / detail::group_width - 1;
+    size_t base = ((hash >> 7) & groupMask) * detail::group_width;
+    detail::prefetch(&ctrl[base]);
+    detail::prefetch(&slots[base]);
+}
+
+    // ***********************************************************************
+    // * Function Name: prepareInsert                                        *
+    // * Description: Returns the first empty or deleted slot on the probe   *
+    // *              sequence of hash. The caller guarantees one exists     *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t hash: myhash of the key being inserted                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+size_t HashTable<K, V, open_addressing, Alloc, Hash>::prepareInsert(size_t hash) {
+    size_t groupMask = slots.size() / detail::group_width - 1;
+    size_t group = (hash >> 7) & groupMask;
+    for (size_t step = 1;; ++step) {
+        size_t base = group * detail::group_width;
+        uint32_t free = detail::ProbeGroup(&ctrl[base]).match_empty_or_deleted();
+        if (free) {
+            return base + detail::lowest_bit(free);
+        }
+        group = (group + step) & groupMask;
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: erase                                                *
+    // * Description: Empties a full slot. The slot becomes empty again when *
+    // *              its group was never full, otherwise it is marked       *
+    // *              deleted to keep probes intact                          *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t index: The slot to empty                                   *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+void HashTable<K, V, open_addressing, Alloc, Hash>::erase(size_t index) {
+    size_t groupStart = index & ~(detail::group_width - 1);
+    if (detail::ProbeGroup(&ctrl[groupStart]).match_empty()) {
+        ctrl[index] = detail::ctrl_empty;
+    } else {
+        ctrl[index] = detail::ctrl_deleted;
+        ++deletedCount;
+    }
+    slots[index] = Entry();
+    currentSize--;
+}
+
+    // ***********************************************************************
+    // * Function Name: insertEncoded                                        *
+    // * Description: Adds a pair whose value is already encoded and whose   *
+    // *              key is known to be absent, as when restoring a         *
+    // *              snapshot                                               *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::pair<K, V>&& kv: The key and encoded value                   *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+void HashTable<K, V, open_addressing, Alloc, Hash>::insertEncoded(std::pair<K, V>&& kv) {
+    makeRoom(1);
+    size_t hash = myhash(kv.first);
+    size_t index = prepareInsert(hash);
+    if (ctrl[index] == detail::ctrl_deleted) {
+        --deletedCount;
+    }
+    ctrl[index] = static_cast<int8_t>(hash & 0x7F);
+    slots[index] = Entry(hash, std::move(kv.first), std::move(kv.second));
+    ++currentSize;
+}
+
+    // ***********************************************************************
+    // * Function Name: myhash                                               *
+    // * Description: Calculates the full hash value for a key. The bits are *
+    // *              mixed so both the group index (high bits) and the      *
+    // *              control byte (low 7 bits) are well distributed         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const K& k: The key to hash.                                      *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+size_t HashTable<K, V, open_addressing, Alloc, Hash>::myhash(const K& k) const {
+    return mix(hasher(k));
+}
+
+    // ***********************************************************************
+    // * Function Name: mix                                                  *
+    // * Description: Spreads the bits of a hash code, which std::hash of an *
+    // *              integer leaves unchanged; myhash of a key and mix of   *
+    // *              the same key's hash_view agree                         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t code: The hasher's value to mix                            *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+size_t HashTable<K, V, open_addressing, Alloc, Hash>::mix(size_t code) {
+    uint64_t h = static_cast<uint64_t>(code);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+}
+
+    // ***********************************************************************
+    // * Function Name: fingerprint                                          *
+    // * Description: Hashes fingerprint_probe with the table's              *
+    // *              hasher. Snapshots carry it so that slot positions      *
+    // *              are only trusted by a table that hashes the            *
+    // *              same way                                               *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+uint64_t HashTable<K, V, open_addressing, Alloc, Hash>::fingerprint() const {
+    return static_cast<uint64_t>(detail::hash_view(hasher, fingerprint_probe));
+}
+
+    // ***********************************************************************
+    // * Function Name: makeRoom                                             *
+    // * Description: Rehashes before extra more entries are added if they   *
+    // *              would push full and deleted slots past the max load    *
+    // *              factor. A table with room only to spare in deleted     *
+    // *              slots is rebuilt at the same size to clear them        *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t extra: The entries about to be added                       *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+void HashTable<K, V, open_addressing, Alloc, Hash>::makeRoom(size_t extra) {
+    // the load limit keeps slots empty so unsuccessful probes terminate
+    if (currentSize + deletedCount + extra <= slots.size() * maxLoad) {
+        return;
+    }
+    size_t capacity = capacityFor(currentSize + extra);
+    if (capacity > slots.size()) {
+        // capacities are powers of two, so the growth factor rounds up to one
+        while (capacity < slots.size() * growth) {
+            capacity *= 2;
+        }
+    }
+    rehash(capacity);
+}
+
+    // ***********************************************************************
+    // * Function Name: capacityFor                                          *
+    // * Description: Smallest power of two slot count, at least one group, *
+    // *              that holds n entries under the max load factor         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t n: number of entries                                       *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+size_t HashTable<K, V, open_addressing, Alloc, Hash>::capacityFor(size_t n) const {
+    size_t capacity = detail::group_width;
+    while (capacity * maxLoad < n) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+    // ***********************************************************************
+    // * Function Name: probeLength                                          *
+    // * Description: Returns how many probe groups find() visits to reach   *
+    // *              the full slot at index                                 *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t index: The full slot                                       *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+size_t HashTable<K, V, open_addressing, Alloc, Hash>::probeLength(size_t index) const {
+    size_t groupMask = slots.size() / detail::group_width - 1;
+    size_t group = (slots[index].hash >> 7) & groupMask;
+    size_t target = index / detail::group_width;
+    size_t step = 1;
+    for (; group != target && step <= groupMask; ++step) {
+        group = (group + step) & groupMask;
+    }
+    return step;
+}
+
+    // ***********************************************************************
+    // * Function Name: toStored                                             *
+    // * Description: Turns a value handed to the table into the form it is  *
+    // *              stored in: encrypted, or unchanged in raw mode         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - V value: The value to store                                       *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+V HashTable<K, V, open_addressing, Alloc, Hash>::toStored(V value) const {
+    if (storage == value_storage::raw) {
+        return value;
+    }
+    return encrypt(value);
+}
+
+    // ***********************************************************************
+    // * Function Name: appendEncoded                                        *
+    // * Description: Appends the encrypted form of a raw value to out,      *
+    // *              encoding in place so formatting a line allocates       *
+    // *              nothing. The bytes match what encrypt returns          *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::string& out: The text to append to                           *
+    // * - const std::string& value: The raw value                           *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+void HashTable<K, V, open_addressing, Alloc, Hash>::appendEncoded(std::string& out, const std::string& value) const {
+    size_t at = out.size();
+    out.resize(at + ((value.size() + 2) / 3) * 4);
+    base64_encode(reinterpret_cast<const BYTE*>(value.data()), reinterpret_cast<BYTE*>(&out[at]), value.size(), 0);
+}
+
+    // ***********************************************************************
+    // * Function Name: decryptExact                                         *
+    // * Description: Inverts encrypt exactly. encrypt turns padding into    *
+    // *              NULs, which decrypt decodes as data; they are dropped  *
+    // *              first here so the original bytes come back unchanged   *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::string_view str: A value as encrypt returned it              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+std::string HashTable<K, V, open_addressing, Alloc, Hash>::decryptExact(std::string_view str) const {
+    while (!str.empty() && str.back() == '\0') {
+        str.remove_suffix(1);
+    }
+    std::string decoded;
+    decoded.resize((str.size() * 3) / 4);
+    size_t decodedLength = base64_decode(reinterpret_cast<const BYTE*>(str.data()), reinterpret_cast<BYTE*>(&decoded[0]), str.size());
+    decoded.resize(decodedLength);
+    return decoded;
+}
+
+    // ***********************************************************************
+    // * Function Name: encrypt                                              *
+    // * Description: Encrypts a string using base64                         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::string& str:  string to be encrypted                   *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+std::string HashTable<K, V, open_addressing, Alloc, Hash>::encrypt(const std::string& str) const {
+    std::string encoded;
+    encoded.resize(((str.size() + 2) / 3) * 4);
+
+    base64_encode(reinterpret_cast<const BYTE*>(str.data()), reinterpret_cast<BYTE*>(&encoded[0]), str.size(), 0);
+    return encoded;
+}
+
+    // ***********************************************************************
+    // * Function Name: decrypt                                              *
+    // * Description: Decrypts a base64 encoded string                       *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::string& str: The string to be decrypted                *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Alloc, typename Hash>
+std::string HashTable<K, V, open_addressing, Alloc, Hash>::decrypt(const std::string& str) const {
+    std::string decoded;
+    decoded.resize((str.size() * 3) / 4);
+
+    base64_decode(reinterpret_cast<const BYTE*>(str.data()), reinterpret_cast<BYTE*>(&decoded[0]), str.size());
+    return decoded;
+}
+
+}
+#endif
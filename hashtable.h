@@ -4,50 +4,535 @@
 #include <vector>
 #include <list>
 #include <string>
+#include <string_view>
 #include <functional>
 #include <algorithm>
+#include <iterator>
 #include <iostream>
 #include <utility>
 #include <fstream>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cmath>
 #include "base64.h"
+#include "cuckoofilter.h"
+#include "fasthash.h"
+#include "mappedfile.h"
+#include "snapshot.h"
 
 namespace cop4530 {
 
-// max_prime is used by the helpful functions provided to you.
-static const unsigned int max_prime = 1301081;
+// prime_sizes lists the bucket counts rehash() grows through. Each entry is the largest
+// prime below 1.5 * 2^k, so consecutive sizes roughly double and stay clear of powers of two.
+static constexpr unsigned long long prime_sizes[] = {
+    11ULL, 23ULL, 47ULL, 89ULL, 191ULL, 383ULL, 761ULL, 1531ULL, 3067ULL, 6143ULL,
+    12281ULL, 24571ULL, 49139ULL, 98299ULL, 196597ULL, 393209ULL, 786431ULL, 1572853ULL,
+    3145721ULL, 6291449ULL, 12582893ULL, 25165813ULL, 50331599ULL, 100663291ULL,
+    201326557ULL, 402653171ULL, 805306357ULL, 1610612711ULL, 3221225461ULL, 6442450939ULL,
+    12884901877ULL, 25769803751ULL, 51539607551ULL, 103079215087ULL, 206158430183ULL,
+    412316860387ULL, 824633720831ULL, 1649267441651ULL, 3298534883309ULL, 6597069766631ULL,
+    13194139533299ULL, 26388279066623ULL, 52776558133177ULL, 105553116266489ULL,
+    211106232532969ULL, 422212465065953ULL, 844424930131963ULL, 1688849860263901ULL,
+    3377699720527861ULL, 6755399441055731ULL, 13510798882111483ULL, 27021597764222939ULL,
+    54043195528445869ULL, 108086391056891903ULL, 216172782113783773ULL,
+    432345564227567561ULL, 864691128455135207ULL, 1729382256910270433ULL,
+    3458764513820540791ULL, 6917529027641081737ULL, 13835058055282163681ULL
+};
 // the default_capacity is used if the initial capacity of the underlying vector of the hash table is zero. 
 static const unsigned int default_capacity = 11;
+// rehash_step is the number of old buckets moved by each insert or remove while an incremental rehash is in progress.
+static const unsigned int rehash_step = 4;
+// batch_window is how many keys of a batched call have their buckets prefetched before any of them is resolved.
+static const unsigned int batch_window = 32;
+// write_grain is how many buckets (or slots) one thread formats into a chunk of text for write() and dump().
+static const size_t write_grain = 1 << 15;
+// cow_segment is how many buckets a write copies for a live CowSnapshot the first time it changes one of them.
+static const size_t cow_segment = 256;
+static_assert(write_grain % cow_segment == 0, "a chunk of text must cover whole copy-on-write segments");
+// parallel_grain is the fewest entries each thread of a parallel rehash or bulk_build is given.
+static const size_t parallel_grain = 1 << 14;
+// default_max_load_factor is how many entries per bucket a chained table holds before it grows.
+static const double default_max_load_factor = 1.0;
+// flat_max_load_factor is the default and the ceiling for open_addressing, which needs empty slots to end its probes.
+static const double flat_max_load_factor = 0.875;
+// default_growth_factor is how many times larger a table becomes each time it grows. A chained table
+// grows by a power of two in steps along prime_sizes and by any other factor to the largest prime
+// at or below the target, so either way it ends up close to the factor asked for.
+static const double default_growth_factor = 2.0;
+
+namespace detail {
+
+// asks the cache for the line holding p without waiting for it
+inline void prefetch(const void* p) {
+#if defined(__GNUC__)
+    __builtin_prefetch(p);
+#else
+    (void)p;
+#endif
+}
 
+// A Q may be looked up in a table keyed by K without building a K: K is
+// std::string and Q is a std::string_view, a C string or a string literal.
+template <typename K, typename Q>
+using enable_view_lookup = typename std::enable_if<
+    std::is_same<K, std::string>::value &&
+    !std::is_same<typename std::decay<Q>::type, std::string>::value &&
+    std::is_convertible<const Q&, std::string_view>::value>::type;
+
+// Hashes a view with a table's Hash without building a string when it can:
+// a hasher that takes a view is handed one, and std::hash<std::string> is
+// swapped for std::hash<std::string_view>, which the standard defines to
+// give the same result for the same characters.
+template <typename Hash>
+size_t hash_view(const Hash& hasher, std::string_view s) {
+    if constexpr (std::is_invocable_r<size_t, const Hash&, std::string_view>::value) {
+        return hasher(s);
+    } else if constexpr (std::is_same<Hash, std::hash<std::string>>::value) {
+        return std::hash<std::string_view>()(s);
+    } else {
+        return hasher(std::string(s));
+    }
+}
+
+// An entry of a table: the key value pair and the full hash of its key.
+// Rehashing places entries by the stored hash instead of hashing every key
+// again, and a scan skips any entry whose hash differs before comparing keys.
 template <typename K, typename V>
+struct HashedEntry : std::pair<K, V> {
+    size_t hash;
+
+    HashedEntry() : std::pair<K, V>(), hash(0) {}
+    template <typename A, typename B>
+    HashedEntry(size_t code, A&& key, B&& value)
+        : std::pair<K, V>(std::forward<A>(key), std::forward<B>(value)), hash(code) {}
+};
+
+// Computes h % d with multiplies in place of a division, which costs tens of
+// cycles on most x86 cores and sits on the path of every chained lookup. The
+// remainder is exact for every 64-bit h and d (Lemire, Kaser and Kurz,
+// "Faster Remainder by Direct Computation", 2019), so buckets are where %
+// puts them. Without 128-bit integers it falls back to %.
+class FastMod {
+public:
+    explicit FastMod(size_t d = 1) : divisor(d ? d : 1) {
+#if defined(__SIZEOF_INT128__)
+        inverse = ~static_cast<__uint128_t>(0) / divisor + 1;
+#endif
+    }
+    size_t operator()(size_t h) const {
+#if defined(__SIZEOF_INT128__)
+        __uint128_t low = inverse * h;
+        __uint128_t bottom = (static_cast<__uint128_t>(static_cast<uint64_t>(low)) * divisor) >> 64;
+        __uint128_t top = static_cast<__uint128_t>(static_cast<uint64_t>(low >> 64)) * divisor;
+        return static_cast<size_t>((bottom + top) >> 64);
+#else
+        return h % divisor;
+#endif
+    }
+
+private:
+    size_t divisor;
+#if defined(__SIZEOF_INT128__)
+    __uint128_t inverse;
+#endif
+};
+
+// appends a key or value as operator<< would print it
+template <typename T>
+void append_text(std::string& out, const T& field) {
+    if constexpr (std::is_convertible<const T&, std::string_view>::value) {
+        out.append(std::string_view(field));
+    } else {
+        std::ostringstream text;
+        text << field;
+        out += text.str();
+    }
+}
+
+// appends the base64 text encrypt() makes of a raw value, encoding in place
+inline void append_encoded(std::string& out, const std::string& value) {
+    size_t at = out.size();
+    out.resize(at + ((value.size() + 2) / 3) * 4);
+    base64_encode(reinterpret_cast<const BYTE*>(value.data()), reinterpret_cast<BYTE*>(&out[at]), value.size(), 0);
+}
+
+// runs f(0) to f(workers - 1) at once, f(0) on the calling thread
+template <typename F>
+void run_parallel(size_t workers, F f) {
+    std::vector<std::thread> threads;
+    for (size_t w = 1; w < workers; ++w) {
+        threads.emplace_back(f, w);
+    }
+    f(0);
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+// Formats positions [0, count) as text, write_grain positions per chunk.
+// Each round formats up to one chunk per hardware thread at once with
+// format(begin, end, chunk), then hands the chunks to emit(chunk) in
+// position order, so the text comes out as a serial walk would produce it.
+// Stops and returns false as soon as emit does.
+template <typename Format, typename Emit>
+bool format_chunks(size_t count, Format format, Emit emit) {
+    size_t workers = std::max<size_t>(1, std::thread::hardware_concurrency());
+    workers = std::max<size_t>(1, std::min(workers, (count + write_grain - 1) / write_grain));
+    std::vector<std::string> chunks(workers);
+    std::vector<std::thread> threads;
+    for (size_t first = 0; first < count; first += workers * write_grain) {
+        size_t round = std::min(workers, (count - first + write_grain - 1) / write_grain);
+        auto run = [&](size_t c) {
+            size_t begin = first + c * write_grain;
+            chunks[c].clear();
+            format(begin, std::min(count, begin + write_grain), chunks[c]);
+        };
+        for (size_t c = 1; c < round; ++c) {
+            threads.emplace_back(run, c);
+        }
+        run(0);
+        for (auto& t : threads) {
+            t.join();
+        }
+        threads.clear();
+        for (size_t c = 0; c < round; ++c) {
+            if (!emit(chunks[c])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace detail
+
+// Layout tags selecting the storage backend of HashTable. separate_chaining
+// is the vector-of-lists table; open_addressing is the flat table declared in
+// flathashtable.h that probes 16 control bytes at a time.
+struct separate_chaining {};
+struct open_addressing {};
+
+// How a table holds its values. encoded keeps every value base64 encoded,
+// as the table always has. raw keeps the bytes it was given, a quarter
+// fewer, and encodes only at the edges: dump, write and snapshots. match
+// then compares bytes without encoding the candidate, and getpassword
+// returns exactly the value that was inserted.
+enum class value_storage { encoded, raw };
+
+// Calls of one operation that found their key (for insert, added it) and
+// calls that did not. A batched call counts once per key.
+struct OpStats {
+    size_t hits = 0;
+    size_t misses = 0;
+};
+
+// What stats() reports. The counters are kept as the table runs; the shape
+// is measured by walking the table when stats() is called.
+struct TableStats {
+    size_t size = 0;
+    size_t buckets = 0;                // lists, or slots for open_addressing
+    double load_factor = 0;            // size / buckets
+    std::vector<size_t> chain_lengths; // [n] is how many lists hold n entries, or for
+                                       // open_addressing how many entries take n probe groups
+    size_t max_probe = 0;              // longest chain, or most probe groups an entry takes
+    size_t rehashes = 0;
+    double rehash_seconds = 0;         // includes the steps of incremental rehashes
+    OpStats lookups;                   // contains and getpassword
+    OpStats matches;
+    OpStats inserts;
+    OpStats removes;
+    size_t bytes = 0;                  // estimated heap bytes of buckets, entries, strings and filter
+    size_t filter_bytes = 0;           // the negative filter, 0 when it is off
+    size_t filter_rejections = 0;      // absent keys the filter turned away before the buckets
+    size_t filter_false_positives = 0; // absent keys the filter let through to the buckets
+    double filter_false_positive_rate = 0; // false positives / (rejections + false positives)
+};
+
+namespace detail {
+
+// Counts one operation. Const lookups count as well, so the counts are
+// atomic, but each is bumped with a relaxed load and store rather than a
+// locked add: readers racing on one table may lose a count, never tear one,
+// and a lone thread pays no more than for a plain increment.
+class OpCounter {
+public:
+    OpCounter() : hits(0), misses(0) {}
+    OpCounter(const OpCounter& rhs) : hits(rhs.hits.load(std::memory_order_relaxed)),
+                                      misses(rhs.misses.load(std::memory_order_relaxed)) {}
+    OpCounter& operator=(const OpCounter& rhs) {
+        hits.store(rhs.hits.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        misses.store(rhs.misses.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return *this;
+    }
+    void count(bool hit, size_t times = 1) const {
+        std::atomic<size_t>& counter = hit ? hits : misses;
+        counter.store(counter.load(std::memory_order_relaxed) + times, std::memory_order_relaxed);
+    }
+    OpStats read() const {
+        OpStats stats;
+        stats.hits = hits.load(std::memory_order_relaxed);
+        stats.misses = misses.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    mutable std::atomic<size_t> hits;
+    mutable std::atomic<size_t> misses;
+};
+
+// The counters behind stats(). Rehashing only happens in non-const calls,
+// so its totals are plain integers.
+struct TableCounters {
+    OpCounter lookups;
+    OpCounter matches;
+    OpCounter inserts;
+    OpCounter removes;
+    OpCounter filtered; // hits are rejections, misses false positives
+    size_t rehashes = 0;
+    uint64_t rehashNanos = 0;
+
+    void report(TableStats& stats) const {
+        stats.lookups = lookups.read();
+        stats.matches = matches.read();
+        stats.inserts = inserts.read();
+        stats.removes = removes.read();
+        OpStats filter = filtered.read();
+        stats.filter_rejections = filter.hits;
+        stats.filter_false_positives = filter.misses;
+        if (filter.hits + filter.misses > 0) {
+            stats.filter_false_positive_rate = static_cast<double>(filter.misses) / (filter.hits + filter.misses);
+        }
+        stats.rehashes = rehashes;
+        stats.rehash_seconds = rehashNanos / 1e9;
+    }
+};
+
+// nanoseconds since start, for the rehash timings
+inline uint64_t nanos_since(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+// heap bytes a key or value owns beyond its own size; a string whose
+// characters fit inside the object owns none
+template <typename T>
+size_t heap_bytes(const T& field) {
+    if constexpr (std::is_same<T, std::string>::value) {
+        const char* chars = field.data();
+        const char* self = reinterpret_cast<const char*>(&field);
+        return chars >= self && chars < self + sizeof(field) ? 0 : field.capacity() + 1;
+    } else {
+        (void)field;
+        return 0;
+    }
+}
+
+// adds one list length or probe count to a histogram
+inline void add_to_histogram(std::vector<size_t>& histogram, size_t n) {
+    if (histogram.size() <= n) {
+        histogram.resize(n + 1, 0);
+    }
+    ++histogram[n];
+}
+
+} // namespace detail
+
+// Alloc allocates the entries: the list nodes of separate_chaining and the
+// slot array of open_addressing. arena.h bundles an arena that packs the
+// nodes of a bulk load into a few large chunks. A copy of the table takes
+// its allocator from select_on_container_copy_construction.
+//
+// Hash hashes the keys. Each entry keeps the full hash of its key, so the
+// hasher runs once per insert and lookup and never while rehashing.
+// fasthash.h bundles fast_hash, which hashes strings several times faster
+// than std::hash and spreads them far better. A table whose hasher takes a
+// std::string_view looks views up without building a string.
+//
+// set_negative_filter(true) keeps a CuckooFilter of the entries' hash codes
+// beside the buckets. Lookups, matches, removes and inserts of a key the
+// filter has never seen then end without touching the bucket array, which
+// is most of the cost of a miss once the table outgrows the cache.
+//
+// cow_snapshot() returns a point-in-time CowSnapshot of a chained table in
+// time proportional to its buckets / cow_segment, without copying entries.
+// The snapshot's writes may run on other threads while the table's own
+// thread keeps changing it: the first change to a segment of cow_segment
+// buckets while the snapshot lives copies that segment's entries for the
+// snapshot, so segments the writer never touches are never copied.
+//
+// A rehash that moves every bucket at once, and bulk_build, split their
+// work across set_build_threads threads, all the hardware has by default,
+// once there are parallel_grain entries per thread. The rehash is two
+// passes with no locks: each thread splices the nodes of its share of the
+// old buckets into staging lists, one per range of new buckets, and then
+// each thread drains the staging lists of its range. bulk_build hashes and
+// encodes its pairs on every thread and links them the same way; with an
+// allocator that has state, such as an arena, which may not be thread-safe,
+// the nodes are allocated and linked on the calling thread. Either way the
+// chains come out in the order a serial rehash, or inserting the pairs one
+// at a time after a reserve(), would leave them.
+template <typename K, typename V, typename Layout = separate_chaining,
+          typename Alloc = std::allocator<std::pair<K, V>>, typename Hash = std::hash<K>>
 class HashTable {
+    static_assert(std::is_same<Layout, separate_chaining>::value,
+                  "HashTable layout must be separate_chaining or open_addressing");
+    static_assert(std::is_same<typename std::allocator_traits<Alloc>::value_type, std::pair<K, V>>::value,
+                  "HashTable allocator must allocate std::pair<K, V>");
 public:
-    explicit HashTable(size_t size = 101);
+    explicit HashTable(size_t size = 101, const Alloc& alloc = Alloc());
+    explicit HashTable(const std::vector<std::pair<K, V>>& kvs, const Alloc& alloc = Alloc());
+    HashTable(const HashTable& rhs);
+    HashTable& operator=(const HashTable& rhs);
     ~HashTable();
     bool contains(const K& k) const;
     bool match(const std::pair<K, V>& kv) const;
     bool insert(const std::pair<K, V>& kv);
     bool insert(std::pair<K, V>&& kv);
+    std::vector<bool> contains_many(const std::vector<K>& keys) const;
+    std::vector<bool> match_many(const std::vector<std::pair<K, V>>& kvs) const;
+    std::vector<bool> insert_many(const std::vector<std::pair<K, V>>& kvs);
+    void bulk_build(const std::vector<std::pair<K, V>>& kvs);
+    template <typename Make>
+    void bulk_build(size_t n, Make make);
     bool remove(const K& k);
+    template <typename Q, typename = detail::enable_view_lookup<K, Q>>
+    bool contains(const Q& k) const;
+    template <typename Q, typename = detail::enable_view_lookup<K, Q>>
+    bool remove(const Q& k);
     void clear();
-    std::string getpassword(const std::string& user) const;
+    std::string getpassword(std::string_view user) const;
     bool load(const char* filename);
     void dump() const;
     bool write(const char* filename) const;
+    bool write(std::ostream& out) const;
+    bool write_snapshot(const char* filename) const;
+    bool load_snapshot(const char* filename);
     size_t size() const; // added size function
+    void set_incremental_rehash(bool on);
+    void set_value_storage(value_storage mode);
+    void set_negative_filter(bool on);
+    void set_build_threads(size_t threads);
+    class CowSnapshot;
+    std::shared_ptr<const CowSnapshot> cow_snapshot();
+    TableStats stats() const;
+    void reserve(size_t n);
+    bool set_max_load_factor(double factor);
+    bool set_growth_factor(double factor);
 
 private:
-    std::vector<std::list<std::pair<K, V>>> Lists;
+    typedef detail::HashedEntry<K, V> Entry;
+    typedef typename std::allocator_traits<Alloc>::template rebind_alloc<Entry> EntryAlloc;
+    typedef std::list<Entry, EntryAlloc> Chain;
+    std::vector<Chain> Lists;
+    std::vector<Chain> oldLists; // buckets still being migrated by an incremental rehash
+    size_t migrated;             // oldLists[0, migrated) have been moved into Lists
     size_t currentSize;
+    bool incremental;
+    size_t buildThreads;         // threads for a whole rehash or bulk_build, 0 for all the hardware has
+    EntryAlloc alloc;            // every list gets it, so nodes splice between them
+    Hash hasher;
+    detail::FastMod listsMod;    // reduces a hash to an index of Lists
+    detail::FastMod oldListsMod; // and of oldLists
+    value_storage storage;
+    detail::TableCounters counters;
+    double maxLoad;
+    double growth;
+    CuckooFilter filter;         // hash codes of every entry, when set_negative_filter is on
+    struct CowState;
+    std::shared_ptr<CowState> cow; // shared with the last CowSnapshot while it may read Lists
     void makeEmpty();
-    void rehash();
+    bool overloaded() const;
+    size_t grownSize(size_t buckets) const;
+    void rehash(size_t newSize);
+    void migrate(size_t buckets, bool whole = false);
+    void migrateParallel(size_t threads);
+    size_t workers(size_t entries) const;
+    void resetReducers();
+    std::vector<Chain> emptyLists(size_t n) const;
+    std::vector<Chain> copyLists(const std::vector<Chain>& from) const;
+    void insertEncoded(std::pair<K, V>&& kv);
+    bool rejects(size_t code) const;
+    void countFalsePositive() const;
+    void filterAdd(size_t code);
+    void rebuildFilter(size_t keys);
+    void preserve(size_t segment);
+    void preserveAll();
+    template <typename Emit>
+    bool writeText(Emit emit) const;
+    Chain& bucketAt(size_t code);
+    const Chain& bucketAt(size_t code) const;
     size_t myhash(const K& k) const;
+    uint64_t fingerprint() const;
     unsigned long prime_below(unsigned long) const;
-    void setPrimes(std::vector<unsigned long>&) const;
+    unsigned long next_prime(unsigned long) const;
+    V toStored(V value) const;
+    void appendEncoded(std::string& out, const std::string& value) const;
+    std::string decryptExact(std::string_view str) const;
     std::string encrypt(const std::string& str) const;
     std::string decrypt(const std::string& str) const;
 };
 
+// What a CowSnapshot and the table it came from share. Each segment of
+// cow_segment buckets is live, read by the snapshot straight from the
+// table's Lists; busy, held for a moment by one side; or preserved, its
+// entries copied into preserved before the table first changed it. Once
+// a segment is preserved the table may change it freely. The copies use
+// the default allocator, so whichever thread drops the state frees them.
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+struct HashTable<K, V, Layout, Alloc, Hash>::CowState {
+    enum : unsigned char { live, busy, preserved };
+    struct Record {
+        size_t bucket;
+        K key;
+        V value;
+    };
+
+    explicit CowState(size_t n) : segments(n), states(new std::atomic<unsigned char>[n]), copies(n) {
+        for (size_t i = 0; i < n; ++i) {
+            states[i].store(live, std::memory_order_relaxed);
+        }
+    }
+    size_t segments;
+    std::unique_ptr<std::atomic<unsigned char>[]> states;
+    std::vector<std::vector<Record>> copies;
+};
+
+// A read-only image of a chained HashTable as it was when cow_snapshot()
+// returned it. write() and write_snapshot() produce what the table's own
+// write() and write_snapshot() would have then, and may run on any thread,
+// several at once, while the table's thread keeps changing the table.
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+class HashTable<K, V, Layout, Alloc, Hash>::CowSnapshot {
+public:
+    CowSnapshot(const CowSnapshot&) = delete;
+    CowSnapshot& operator=(const CowSnapshot&) = delete;
+    size_t size() const;
+    bool write(const char* filename) const;
+    bool write(std::ostream& out) const;
+    bool write_snapshot(const char* filename) const;
+
+private:
+    friend class HashTable;
+    CowSnapshot() = default;
+    std::shared_ptr<CowState> state;
+    const std::vector<Chain>* lists; // the table's buckets, read only in live segments
+    size_t buckets;
+    size_t records;
+    value_storage storage;
+    uint64_t hashFingerprint;
+    template <typename Visit>
+    void visit(size_t segment, Visit visit) const;
+    template <typename Emit>
+    bool writeText(Emit emit) const;
+};
+
 } 
 #include "hashtable.hpp"
+#include "flathashtable.h"
 
 #endif 
@@ -12,18 +12,100 @@ namespace cop4530 {
     // *                                                                     *
     // * Parameter Description:                                              *
     // * - size_t size: initial size of the hash table                       *
+    // * - const Alloc& alloc: allocator for the entries                     *
     // *                                                                     *
     // * Date: 7/17/2024                                                     *
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-template <typename K, typename V>
-HashTable<K, V>::HashTable(size_t size) : currentSize(0) {
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+HashTable<K, V, Layout, Alloc, Hash>::HashTable(size_t size, const Alloc& alloc)
+    : migrated(0), currentSize(0), incremental(false), buildThreads(0), alloc(alloc), storage(value_storage::encoded),
+      maxLoad(default_max_load_factor), growth(default_growth_factor) {
      if (size < 1) {
         size = 101;
     }
     size_t primeSize = prime_below(size);
-    Lists.resize(primeSize);
+    if (primeSize == 0) {
+        primeSize = default_capacity;
+    }
+    Lists = emptyLists(primeSize);
+    resetReducers();
+}
+
+    // ***********************************************************************
+    // * Function Name: HashTable                                            *
+    // * Description: Constructs a table holding the given pairs, built      *
+    // *              with bulk_build. Of pairs with equal keys the first    *
+    // *              is kept                                                *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::vector<std::pair<K, V>>& kvs: The pairs to hold        *
+    // * - const Alloc& alloc: allocator for the entries                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+HashTable<K, V, Layout, Alloc, Hash>::HashTable(const std::vector<std::pair<K, V>>& kvs, const Alloc& alloc)
+    : HashTable(101, alloc) {
+    bulk_build(kvs);
+}
+
+    // ***********************************************************************
+    // * Function Name: HashTable                                            *
+    // * Description: Copy constructor. The copy gets the allocator          *
+    // *              select_on_container_copy_construction picks, the       *
+    // *              default resource for an ArenaAllocator, and keeps any  *
+    // *              rehash in progress                                     *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const HashTable& rhs: The table to copy                           *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+HashTable<K, V, Layout, Alloc, Hash>::HashTable(const HashTable& rhs)
+    : migrated(rhs.migrated), currentSize(rhs.currentSize), incremental(rhs.incremental), buildThreads(rhs.buildThreads),
+      alloc(std::allocator_traits<Alloc>::select_on_container_copy_construction(rhs.alloc)),
+      hasher(rhs.hasher), storage(rhs.storage), counters(rhs.counters), maxLoad(rhs.maxLoad), growth(rhs.growth),
+      filter(rhs.filter) {
+    Lists = copyLists(rhs.Lists);
+    oldLists = copyLists(rhs.oldLists);
+    resetReducers();
+}
+
+    // ***********************************************************************
+    // * Function Name: operator=                                            *
+    // * Description: Copy assignment. The table keeps its own allocator and *
+    // *              copies the entries of rhs into it                      *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const HashTable& rhs: The table to copy                           *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+HashTable<K, V, Layout, Alloc, Hash>& HashTable<K, V, Layout, Alloc, Hash>::operator=(const HashTable& rhs) {
+    if (this != &rhs) {
+        preserveAll();
+        Lists = copyLists(rhs.Lists);
+        oldLists = copyLists(rhs.oldLists);
+        resetReducers();
+        hasher = rhs.hasher;
+        migrated = rhs.migrated;
+        currentSize = rhs.currentSize;
+        incremental = rhs.incremental;
+        buildThreads = rhs.buildThreads;
+        storage = rhs.storage;
+        counters = rhs.counters;
+        maxLoad = rhs.maxLoad;
+        growth = rhs.growth;
+        filter = rhs.filter;
+    }
+    return *this;
 }
 
     // ***********************************************************************
@@ -35,8 +117,8 @@ HashTable<K, V>::HashTable(size_t size) : currentSize(0) {
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-template <typename K, typename V>
-HashTable<K, V>::~HashTable() {
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+HashTable<K, V, Layout, Alloc, Hash>::~HashTable() {
     clear();
 }
 
@@ -50,14 +132,22 @@ HashTable<K, V>::~HashTable() {
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-template <typename K, typename V>
-bool HashTable<K, V>::contains(const K& k) const {
-    auto& selectedList = Lists[myhash(k)];
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+bool HashTable<K, V, Layout, Alloc, Hash>::contains(const K& k) const {
+    size_t code = hasher(k);
+    if (rejects(code)) {
+        counters.lookups.count(false);
+        return false;
+    }
+    auto& selectedList = bucketAt(code);
     for (const auto& kv : selectedList) {
-    if (kv.first == k) {
+    if (kv.hash == code && kv.first == k) {
+        counters.lookups.count(true);
         return true;
     }
 }
+    countFalsePositive();
+    counters.lookups.count(false);
     return false;
 }
 
@@ -72,15 +162,26 @@ bool HashTable<K, V>::contains(const K& k) const {
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-template <typename K, typename V>
-bool HashTable<K, V>::match(const std::pair<K, V>& kv) const {
-    auto encryptedValue = encrypt(kv.second);
-    auto& selectedList = Lists[myhash(kv.first)];
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+bool HashTable<K, V, Layout, Alloc, Hash>::match(const std::pair<K, V>& kv) const {
+    size_t code = hasher(kv.first);
+    if (rejects(code)) {
+        counters.matches.count(false);
+        return false;
+    }
+    bool raw = storage == value_storage::raw;
+    std::string encryptedValue = raw ? std::string() : encrypt(kv.second);
+    const V& wanted = raw ? kv.second : encryptedValue;
+    auto& selectedList = bucketAt(code);
     for (const auto& pair : selectedList) {
-        if (pair.first == kv.first && pair.second == encryptedValue) {
-            return true;
+        if (pair.hash == code && pair.first == kv.first) {
+            bool same = pair.second == wanted;
+            counters.matches.count(same);
+            return same;
         }
     }
+    countFalsePositive();
+    counters.matches.count(false);
     return false;
 }
 
@@ -94,17 +195,26 @@ bool HashTable<K, V>::match(const std::pair<K, V>& kv) const {
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-template <typename K, typename V>
-bool HashTable<K, V>::insert(const std::pair<K, V>& kv) {
-    auto& selectedList = Lists[myhash(kv.first)];
-    for (const auto& pair : selectedList) {
-        if (pair.first == kv.first) {
-            return false;
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+bool HashTable<K, V, Layout, Alloc, Hash>::insert(const std::pair<K, V>& kv) {
+    migrate(rehash_step);
+    size_t code = hasher(kv.first);
+    auto& selectedList = bucketAt(code);
+    if (!rejects(code)) {
+        for (const auto& pair : selectedList) {
+            if (pair.hash == code && pair.first == kv.first) {
+                counters.inserts.count(false);
+                return false;
+            }
         }
+        countFalsePositive();
     }
-    selectedList.push_back({kv.first, encrypt(kv.second)});
-    if (++currentSize > Lists.size()) {
-        rehash();
+    selectedList.emplace_back(code, kv.first, toStored(kv.second));
+    counters.inserts.count(true);
+    ++currentSize;
+    filterAdd(code);
+    if (overloaded()) {
+        rehash(grownSize(Lists.size()));
     }
     return true;
 }
@@ -120,22 +230,276 @@ bool HashTable<K, V>::insert(const std::pair<K, V>& kv) {
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-template <typename K, typename V>
-bool HashTable<K, V>::insert(std::pair<K, V>&& kv) {
-    auto& selectedList = Lists[myhash(kv.first)];
-    for (const auto& pair : selectedList) {
-        if (pair.first == kv.first) {
-            return false;
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+bool HashTable<K, V, Layout, Alloc, Hash>::insert(std::pair<K, V>&& kv) {
+    migrate(rehash_step);
+    size_t code = hasher(kv.first);
+    auto& selectedList = bucketAt(code);
+    if (!rejects(code)) {
+        for (const auto& pair : selectedList) {
+            if (pair.hash == code && pair.first == kv.first) {
+                counters.inserts.count(false);
+                return false;
+            }
         }
+        countFalsePositive();
     }
-    selectedList.push_back({std::move(kv.first), encrypt(std::move(kv.second))});
-    
-    if (++currentSize > Lists.size()) {
-        rehash();
+    selectedList.emplace_back(code, std::move(kv.first), toStored(std::move(kv.second)));
+    counters.inserts.count(true);
+    ++currentSize;
+    filterAdd(code);
+    if (overloaded()) {
+        rehash(grownSize(Lists.size()));
     }
     return true;
 }
 
+    // ***********************************************************************
+    // * Function Name: contains_many                                        *
+    // * Description: Checks a batch of keys. Each window of batch_window    *
+    // *              keys is hashed and its buckets prefetched first, then  *
+    // *              the first nodes are prefetched, and only then are the  *
+    // *              chains walked, so the cache misses of the window       *
+    // *              overlap instead of being paid one key at a time        *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::vector<K>& keys: The keys to look for                  *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+std::vector<bool> HashTable<K, V, Layout, Alloc, Hash>::contains_many(const std::vector<K>& keys) const {
+    std::vector<bool> found(keys.size(), false);
+    const Chain* window[batch_window];
+    size_t codes[batch_window];
+    for (size_t start = 0; start < keys.size(); start += batch_window) {
+        size_t count = std::min<size_t>(batch_window, keys.size() - start);
+        for (size_t i = 0; i < count; ++i) {
+            codes[i] = hasher(keys[start + i]);
+            window[i] = rejects(codes[i]) ? nullptr : &bucketAt(codes[i]);
+            detail::prefetch(window[i]);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (window[i] && !window[i]->empty()) {
+                detail::prefetch(&window[i]->front());
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (window[i]) {
+                for (const auto& kv : *window[i]) {
+                    if (kv.hash == codes[i] && kv.first == keys[start + i]) {
+                        found[start + i] = true;
+                        break;
+                    }
+                }
+                if (!found[start + i]) {
+                    countFalsePositive();
+                }
+            }
+            counters.lookups.count(found[start + i]);
+        }
+    }
+    return found;
+}
+
+    // ***********************************************************************
+    // * Function Name: match_many                                           *
+    // * Description: Checks a batch of key value pairs the same way as      *
+    // *              contains_many. Encoded tables encrypt the values while *
+    // *              the bucket prefetches are in flight                    *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::vector<std::pair<K, V>>& kvs: The pairs to check for   *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+std::vector<bool> HashTable<K, V, Layout, Alloc, Hash>::match_many(const std::vector<std::pair<K, V>>& kvs) const {
+    std::vector<bool> matched(kvs.size(), false);
+    const Chain* window[batch_window];
+    size_t codes[batch_window];
+    std::string encrypted[batch_window];
+    const V* wanted[batch_window];
+    bool raw = storage == value_storage::raw;
+    for (size_t start = 0; start < kvs.size(); start += batch_window) {
+        size_t count = std::min<size_t>(batch_window, kvs.size() - start);
+        for (size_t i = 0; i < count; ++i) {
+            codes[i] = hasher(kvs[start + i].first);
+            window[i] = rejects(codes[i]) ? nullptr : &bucketAt(codes[i]);
+            detail::prefetch(window[i]);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (!window[i]) {
+                continue;
+            }
+            if (raw) {
+                wanted[i] = &kvs[start + i].second;
+            } else {
+                encrypted[i] = encrypt(kvs[start + i].second);
+                wanted[i] = &encrypted[i];
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (window[i] && !window[i]->empty()) {
+                detail::prefetch(&window[i]->front());
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (window[i]) {
+                bool present = false;
+                for (const auto& pair : *window[i]) {
+                    if (pair.hash == codes[i] && pair.first == kvs[start + i].first) {
+                        matched[start + i] = pair.second == *wanted[i];
+                        present = true;
+                        break;
+                    }
+                }
+                if (!present) {
+                    countFalsePositive();
+                }
+            }
+            counters.matches.count(matched[start + i]);
+        }
+    }
+    return matched;
+}
+
+    // ***********************************************************************
+    // * Function Name: insert_many                                          *
+    // * Description: Inserts a batch of key value pairs. The buckets of     *
+    // *              each window are prefetched before its inserts run.     *
+    // *              An insert may rehash, so the inserts look their        *
+    // *              buckets up again rather than reuse the prefetched ones *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::vector<std::pair<K, V>>& kvs: The pairs to insert      *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+std::vector<bool> HashTable<K, V, Layout, Alloc, Hash>::insert_many(const std::vector<std::pair<K, V>>& kvs) {
+    std::vector<bool> inserted(kvs.size(), false);
+    for (size_t start = 0; start < kvs.size(); start += batch_window) {
+        size_t count = std::min<size_t>(batch_window, kvs.size() - start);
+        for (size_t i = 0; i < count; ++i) {
+            detail::prefetch(&bucketAt(hasher(kvs[start + i].first)));
+        }
+        for (size_t i = 0; i < count; ++i) {
+            inserted[start + i] = insert(kvs[start + i]);
+        }
+    }
+    return inserted;
+}
+
+    // ***********************************************************************
+    // * Function Name: bulk_build                                           *
+    // * Description: Replaces the contents of the table with the given      *
+    // *              pairs, as clear() and one insert per pair would, but   *
+    // *              with a single rehash and the hashing, encoding and     *
+    // *              linking spread across threads. Of pairs with equal     *
+    // *              keys the first is kept                                 *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::vector<std::pair<K, V>>& kvs: The pairs to hold        *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::bulk_build(const std::vector<std::pair<K, V>>& kvs) {
+    bulk_build(kvs.size(), [&kvs](size_t i) {
+        return kvs[i];
+    });
+}
+
+    // ***********************************************************************
+    // * Function Name: bulk_build                                           *
+    // * Description: Replaces the contents of the table with the pairs      *
+    // *              make(0) to make(n - 1). Each thread makes, hashes      *
+    // *              and encodes a contiguous share of the pairs and files  *
+    // *              their indices by the range of buckets they land in;    *
+    // *              then each thread links the pairs of one range, in      *
+    // *              index order, so the chains match what reserve(n) and   *
+    // *              inserting the pairs in order would give. make is       *
+    // *              called from several threads at once, so it must not    *
+    // *              change shared state                                    *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t n: The number of pairs                                     *
+    // * - Make make: Returns pair i as a std::pair<K, V>                    *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+template <typename Make>
+void HashTable<K, V, Layout, Alloc, Hash>::bulk_build(size_t n, Make make) {
+    clear();
+    reserve(n);
+    migrate(oldLists.size(), true);
+    auto present = [](const Chain& selectedList, size_t code, const K& key) {
+        return std::any_of(selectedList.begin(), selectedList.end(), [code, &key](const Entry& kv) {
+            return kv.hash == code && kv.first == key;
+        });
+    };
+    size_t threads = workers(n);
+    if (threads == 1) {
+        // too few pairs to share out, so they go straight into their chains
+        for (size_t i = 0; i < n; ++i) {
+            std::pair<K, V> kv = make(i);
+            size_t code = hasher(kv.first);
+            Chain& selectedList = Lists[listsMod(code)];
+            if (!present(selectedList, code, kv.first)) {
+                selectedList.emplace_back(code, std::move(kv.first), toStored(std::move(kv.second)));
+                ++currentSize;
+            }
+        }
+    } else {
+        size_t buckets = Lists.size();
+        std::vector<Entry> entries(n);
+        std::vector<std::vector<size_t>> parts(threads * threads); // parts[t * threads + p]: made by t, linked by p
+        detail::run_parallel(threads, [&](size_t t) {
+            for (size_t i = n * t / threads; i < n * (t + 1) / threads; ++i) {
+                std::pair<K, V> kv = make(i);
+                size_t code = hasher(kv.first);
+                entries[i] = Entry(code, std::move(kv.first), toStored(std::move(kv.second)));
+                parts[t * threads + listsMod(code) * threads / buckets].push_back(i);
+            }
+        });
+        std::vector<size_t> added(threads, 0);
+        auto link = [&](size_t p) {
+            for (size_t t = 0; t < threads; ++t) {
+                for (size_t i : parts[t * threads + p]) {
+                    Chain& selectedList = Lists[listsMod(entries[i].hash)];
+                    if (!present(selectedList, entries[i].hash, entries[i].first)) {
+                        selectedList.emplace_back(std::move(entries[i]));
+                        ++added[p];
+                    }
+                }
+            }
+        };
+        // nodes come from the allocator, which only a stateless one lets several threads share
+        if (std::allocator_traits<EntryAlloc>::is_always_equal::value) {
+            detail::run_parallel(threads, link);
+        } else {
+            for (size_t p = 0; p < threads; ++p) {
+                link(p);
+            }
+        }
+        for (size_t count : added) {
+            currentSize += count;
+        }
+    }
+    counters.inserts.count(true, currentSize);
+    counters.inserts.count(false, n - currentSize);
+    if (filter.active()) {
+        rebuildFilter(currentSize);
+    }
+}
+
     // ***********************************************************************
     // * Function Name: remove                                               *
     // * Description: Removes a key value pair from the hash table           *
@@ -146,17 +510,99 @@ bool HashTable<K, V>::insert(std::pair<K, V>&& kv) {
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-template <typename K, typename V>
-bool HashTable<K, V>::remove(const K& k) {
-    auto& selectedList = Lists[myhash(k)];
-    auto iterate = std::find_if(selectedList.begin(), selectedList.end(), [&k](const std::pair<K, V>& kv) {
-        return kv.first == k;
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+bool HashTable<K, V, Layout, Alloc, Hash>::remove(const K& k) {
+    migrate(rehash_step);
+    size_t code = hasher(k);
+    if (rejects(code)) {
+        counters.removes.count(false);
+        return false;
+    }
+    auto& selectedList = bucketAt(code);
+    auto iterate = std::find_if(selectedList.begin(), selectedList.end(), [&k, code](const Entry& kv) {
+        return kv.hash == code && kv.first == k;
     });
     if (iterate == selectedList.end()) {
+        countFalsePositive();
+        counters.removes.count(false);
         return false;
     }
       selectedList.erase(iterate);
     currentSize--;
+    if (filter.active()) {
+        filter.erase(code);
+    }
+    counters.removes.count(true);
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: contains                                             *
+    // * Description: Checks if a key is in the hash table without building *
+    // *              a std::string from it                                  *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const Q& k: A string view, C string or literal naming the key     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+template <typename Q, typename>
+bool HashTable<K, V, Layout, Alloc, Hash>::contains(const Q& k) const {
+    std::string_view key(k);
+    size_t code = detail::hash_view(hasher, key);
+    if (rejects(code)) {
+        counters.lookups.count(false);
+        return false;
+    }
+    for (const auto& kv : bucketAt(code)) {
+        if (kv.hash == code && kv.first == key) {
+            counters.lookups.count(true);
+            return true;
+        }
+    }
+    countFalsePositive();
+    counters.lookups.count(false);
+    return false;
+}
+
+    // ***********************************************************************
+    // * Function Name: remove                                               *
+    // * Description: Removes a key value pair from the hash table without   *
+    // *              building a std::string from the key                    *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const Q& k: A string view, C string or literal naming the key     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+template <typename Q, typename>
+bool HashTable<K, V, Layout, Alloc, Hash>::remove(const Q& k) {
+    migrate(rehash_step);
+    std::string_view key(k);
+    size_t code = detail::hash_view(hasher, key);
+    if (rejects(code)) {
+        counters.removes.count(false);
+        return false;
+    }
+    auto& selectedList = bucketAt(code);
+    auto iterate = std::find_if(selectedList.begin(), selectedList.end(), [key, code](const Entry& kv) {
+        return kv.hash == code && kv.first == key;
+    });
+    if (iterate == selectedList.end()) {
+        countFalsePositive();
+        counters.removes.count(false);
+        return false;
+    }
+    selectedList.erase(iterate);
+    currentSize--;
+    if (filter.active()) {
+        filter.erase(code);
+    }
+    counters.removes.count(true);
     return true;
 }
 
@@ -169,8 +615,8 @@ bool HashTable<K, V>::remove(const K& k) {
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-template <typename K, typename V>
-void HashTable<K, V>::clear() {
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::clear() {
     makeEmpty();
 }
 
@@ -178,28 +624,42 @@ void HashTable<K, V>::clear() {
     // * Function Name: getpassword                                          *
     // * Description: Retrieves the password for a user                      *
     // * Parameter Description:                                              *
-    // * - const std::string& user: The username to look up.                 *
+    // * - std::string_view user: The username to look up.                   *
     // *                                                                     *
     // * Date: 7/17/2024                                                     *
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-template <typename K, typename V>
-std::string HashTable<K, V>::getpassword(const std::string& user) const {
-    auto& selectedList = Lists[myhash(user)];
-    auto iterate = std::find_if(selectedList.begin(), selectedList.end(), [&user](const std::pair<K, V>& kv) {
-        return kv.first == user;
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+std::string HashTable<K, V, Layout, Alloc, Hash>::getpassword(std::string_view user) const {
+    size_t code = detail::hash_view(hasher, user);
+    if (rejects(code)) {
+        counters.lookups.count(false);
+        return "NOT FOUND";
+    }
+    auto& selectedList = bucketAt(code);
+    auto iterate = std::find_if(selectedList.begin(), selectedList.end(), [&user, code](const Entry& kv) {
+        return kv.hash == code && kv.first == user;
     });
+    counters.lookups.count(iterate != selectedList.end());
     if (iterate == selectedList.end()) {
+        countFalsePositive();
         return "NOT FOUND";
     }
+    if (storage == value_storage::raw) {
+        return iterate->second;
+    }
     return decrypt(iterate -> second); 
 }
 
     // ***********************************************************************
     // * Function Name: load                                                 *
     // * Description: Loads key-value pairs from file into the hash table    *
-    // *              Clears the current table before loading                *
+    // *              Clears the current table before loading. String        *
+    // *              tables map the file, split its lines in place and hand *
+    // *              them to bulk_build, which builds entries straight from *
+    // *              the mapped bytes with a single rehash; malformed lines *
+    // *              are reported and skipped                               *
     // *                                                                     *
     // * Parameter Description:                                              *
     // * - const char* filename: The name of the file to load from           *
@@ -208,21 +668,37 @@ std::string HashTable<K, V>::getpassword(const std::string& user) const {
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-template <typename K, typename V>
-bool HashTable<K, V>::load(const char* filename) {
-    K key;
-    V value;
-    std::ifstream infile(filename);
-    if (!infile) {
-        return false;
-    }
-    clear();
-    while (infile >> key >> value) {
-        insert({key, value});
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+bool HashTable<K, V, Layout, Alloc, Hash>::load(const char* filename) {
+    if constexpr (std::is_same<K, std::string>::value && std::is_same<V, std::string>::value) {
+        MappedFile file(filename);
+        if (!file.is_open()) {
+            return false;
+        }
+        clear();
+        std::vector<std::pair<std::string_view, std::string_view>> pairs;
+        pairs.reserve(count_lines(file));
+        for_each_pair(file, filename, [&pairs](std::string_view key, std::string_view value) {
+            pairs.emplace_back(key, value);
+        });
+        bulk_build(pairs.size(), [&pairs](size_t i) {
+            return std::pair<K, V>(std::string(pairs[i].first), std::string(pairs[i].second));
+        });
+        return true;
+    } else {
+        K key;
+        V value;
+        std::ifstream infile(filename);
+        if (!infile) {
+            return false;
+        }
+        clear();
+        while (infile >> key >> value) {
+            insert({key, value});
+        }
+        infile.close();
+        return true;
     }
-    infile.close();
-    
-    return true;
 }
 
     // ***********************************************************************
@@ -235,18 +711,16 @@ bool HashTable<K, V>::load(const char* filename) {
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-template <typename K, typename V>
-void HashTable<K, V>::dump() const {
-    for (const auto& selectedList : Lists) {
-        for (const auto& kv : selectedList) {
-            std::cout << kv.first << " " << kv.second << std::endl;
-        }
-    }
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::dump() const {
+    write(std::cout);
 }
 
     // ***********************************************************************
     // * Function Name: write                                                *
     // * Description: Writes all key value pairs in the hash table to a file *
+    // *              through a temp file that is fsynced and renamed over   *
+    // *              it, so a crash never leaves a partial file behind      *
     // *                                                                     *
     // * Parameter Description:                                              *
     // * - const char* filename: The name of the file to write               *
@@ -255,20 +729,75 @@ void HashTable<K, V>::dump() const {
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-template <typename K, typename V>
-bool HashTable<K, V>::write(const char* filename) const {
-    std::ofstream outfile(filename);
-    if (!outfile) {
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+bool HashTable<K, V, Layout, Alloc, Hash>::write(const char* filename) const {
+    AtomicFile outfile;
+    if (!outfile.open(filename)) {
         return false;
     }
-    for (const auto& selectedList : Lists) {
-        for (const auto& kv : selectedList) {
-            outfile << kv.first << " " << kv.second << std::endl;
+    bool written = writeText([&outfile](const std::string& chunk) {
+        return outfile.write(chunk.data(), chunk.size());
+    });
+
+    return written && outfile.commit();
+}
+
+    // ***********************************************************************
+    // * Function Name: write                                                *
+    // * Description: Writes all key value pairs in the hash table to an     *
+    // *              open stream, one pair per line                         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::ostream& out: The stream to write to                         *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+bool HashTable<K, V, Layout, Alloc, Hash>::write(std::ostream& out) const {
+    writeText([&out](const std::string& chunk) {
+        out.write(chunk.data(), chunk.size());
+        return static_cast<bool>(out);
+    });
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+    // ***********************************************************************
+    // * Function Name: writeText                                            *
+    // * Description: Formats every pair as a "key value" line and passes    *
+    // *              the text to emit a chunk at a time. Buckets are split  *
+    // *              into ranges formatted on several threads; the chunks   *
+    // *              still arrive in the order a serial walk would write,   *
+    // *              oldLists[migrated..] first and then Lists              *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - Emit emit: Called with each chunk, returns false to stop          *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+template <typename Emit>
+bool HashTable<K, V, Layout, Alloc, Hash>::writeText(Emit emit) const {
+    size_t pending = oldLists.size() - migrated;
+    auto format = [&](size_t begin, size_t end, std::string& chunk) {
+        for (size_t i = begin; i < end; ++i) {
+            const auto& selectedList = i < pending ? oldLists[migrated + i] : Lists[i - pending];
+            for (const auto& kv : selectedList) {
+                detail::append_text(chunk, kv.first);
+                chunk += ' ';
+                if (storage == value_storage::raw) {
+                    appendEncoded(chunk, kv.second);
+                } else {
+                    detail::append_text(chunk, kv.second);
+                }
+                chunk += '\n';
+            }
         }
-    }
-    outfile.close();
-    
-    return true;
+    };
+    return detail::format_chunks(pending + Lists.size(), format, emit);
 }
 
     // ***********************************************************************
@@ -281,140 +810,690 @@ bool HashTable<K, V>::write(const char* filename) const {
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-template <typename K, typename V>
-void HashTable<K, V>::makeEmpty() {
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::makeEmpty() {
+    preserveAll();
     for (auto& thisList : Lists) {
         thisList.clear();
     }
+    std::vector<Chain>().swap(oldLists);
+    migrated = 0;
     currentSize = 0;
+    resetReducers();
+    filter.clear();
 }
 
     // ***********************************************************************
     // * Function Name: rehash                                               *
-    // * Description: Resizes the hash table and re inserts all key value    *
-    // *              pairs                                                  *
+    // * Description: Resizes the hash table. The current buckets become     *
+    // *              oldLists and their nodes are spliced into the new      *
+    // *              vector, all at once or, in incremental mode, a few     *
+    // *              buckets per later insert or remove                     *
     // *                                                                     *
     // * Parameter Description:                                              *
-    // * - None                                                              *
+    // * - size_t newSize: The new number of buckets                         *
     // * Date: 7/17/2024                                                     *
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-template <typename K, typename V>
-void HashTable<K, V>::rehash() {
-    std::vector<std::list<std::pair<K, V>>> oldLists = Lists;
-    
-    Lists.resize(prime_below(2 * Lists.size()));
-    for (auto& thisList : Lists) {
-        thisList.clear();
-    }
-    currentSize = 0;
-    
-    for (auto& thisList : oldLists) {
-        for (auto& kv : thisList) {
-            insert(std::move(kv));
-        }
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::rehash(size_t newSize) {
+    // a rehash still in progress must finish before the vectors are swapped again
+    migrate(oldLists.size(), true);
+    preserveAll();
+
+    auto start = std::chrono::steady_clock::now();
+    oldLists.swap(Lists);
+    Lists = emptyLists(newSize);
+    migrated = 0;
+    resetReducers();
+    ++counters.rehashes;
+    counters.rehashNanos += detail::nanos_since(start);
+    if (!incremental) {
+        migrate(oldLists.size(), true);
     }
 }
+
     // ***********************************************************************
-    // * Function Name: myhash                                               *
-    // * Description: Calculates the hash value for a key                    *
+    // * Function Name: overloaded                                           *
+    // * Description: Returns true when the table holds more entries than its*
+    // *              max load factor allows                                 *
     // *                                                                     *
     // * Parameter Description:                                              *
-    // * - const K& k: The key to hash.                                      *
+    // * - None                                                              *
     // * Date: 7/17/2024                                                     *
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-template <typename K, typename V>
-size_t HashTable<K, V>::myhash(const K& k) const {
-    static std::hash<K> hf;
-    return hf(k) % Lists.size();
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+bool HashTable<K, V, Layout, Alloc, Hash>::overloaded() const {
+    return currentSize > Lists.size() * maxLoad;
 }
 
-// returns largest prime number <= n or zero if input is too large
-template <typename K, typename V>
-unsigned long HashTable<K, V>::prime_below(unsigned long n) const {
-    if (n > max_prime) {
-        std::cerr << "** input too large for prime_below()\n";
-        return 0;
+    // ***********************************************************************
+    // * Function Name: grownSize                                            *
+    // * Description: Returns the bucket count a table of the given          *
+    // *              size grows to. A factor that is a power of two takes   *
+    // *              that many doubling steps along prime_sizes; any other  *
+    // *              factor takes the largest prime at or below the target  *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t buckets: The current number of buckets                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+size_t HashTable<K, V, Layout, Alloc, Hash>::grownSize(size_t buckets) const {
+    double doublings = std::log2(growth);
+    if (doublings >= 1 && doublings == std::floor(doublings)) {
+        // each step takes the first entry above one and a half times the size, which is
+        // about twice it whether or not the size is itself an entry
+        size_t size = buckets;
+        for (double i = 0; i < doublings; ++i) {
+            size = next_prime(size + size / 2);
+        }
+        return size;
     }
-    if (n == max_prime) {
-        return max_prime;
+    size_t size = prime_below(static_cast<unsigned long>(std::ceil(buckets * growth)));
+    return size > buckets ? size : next_prime(buckets);
+}
+
+    // ***********************************************************************
+    // * Function Name: migrate                                              *
+    // * Description: Moves up to the given number of old buckets into       *
+    // *              Lists by splicing their nodes, so no entry is copied,  *
+    // *              re-encrypted or hashed again. A whole-table move of    *
+    // *              many entries is split across threads; the few buckets  *
+    // *              an incremental step moves are not. Frees oldLists      *
+    // *              when the last bucket has moved                         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t buckets: maximum number of old buckets to move             *
+    // * - bool whole: true when moving every remaining bucket at once, as   *
+    // *   rehash, set_incremental_rehash and bulk_build do                  *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::migrate(size_t buckets, bool whole) {
+    if (oldLists.empty()) {
+        return;
     }
-    if (n <= 1) {
-        std::cerr << "** input too small \n";
-        return 0;
+    auto start = std::chrono::steady_clock::now();
+    if (whole) {
+        size_t entries = 0;
+        for (size_t i = migrated; i < oldLists.size(); ++i) {
+            entries += oldLists[i].size();
+        }
+        size_t threads = workers(entries);
+        if (threads > 1) {
+            migrateParallel(threads);
+        }
     }
-    // now: 2 <= n < max_prime
-    std::vector<unsigned long> v(n + 1);
-    setPrimes(v);
-    while (n > 2) {
-        if (v[n] == 1)
-            return n;
-        --n;
+    for (; buckets > 0 && migrated < oldLists.size(); --buckets, ++migrated) {
+        auto& from = oldLists[migrated];
+        while (!from.empty()) {
+            auto& to = Lists[listsMod(from.front().hash)];
+            to.splice(to.end(), from, from.begin());
+        }
     }
-    return 2;
-}
-
-// Sets all prime number indexes to 1. Called by method prime_below(n)
-template <typename K, typename V>
-void HashTable<K, V>::setPrimes(std::vector<unsigned long>& vprimes) const {
-    int i = 0;
-    int j = 0;
-
-    vprimes[0] = 0;
-    vprimes[1] = 0;
-    int n = vprimes.capacity();
-
-    for (i = 2; i < n; ++i)
-        vprimes[i] = 1;
-
-    for (i = 2; i * i < n; ++i) {
-        if (vprimes[i] == 1)
-            for (j = i + i; j < n; j += i)
-                vprimes[j] = 0;
+    if (migrated == oldLists.size()) {
+        std::vector<Chain>().swap(oldLists);
+        migrated = 0;
+        resetReducers();
     }
+    counters.rehashNanos += detail::nanos_since(start);
 }
 
     // ***********************************************************************
-    // * Function Name: encrypt                                              *
-    // * Description: Encrypts a string using base64                         *
+    // * Function Name: migrateParallel                                      *
+    // * Description: Moves every old bucket not yet moved into Lists on     *
+    // *              the given number of threads. First each thread         *
+    // *              splices the nodes of its share of the old buckets      *
+    // *              into staging lists, one for each range of new buckets; *
+    // *              then each thread drains the staging lists of its own   *
+    // *              range in thread order, so every chain comes out as a   *
+    // *              serial migrate would leave it                          *
     // *                                                                     *
     // * Parameter Description:                                              *
-    // * - const std::string& str:  string to be encrypted                   *
-    // *                                                                     *
+    // * - size_t threads: The number of threads                             *
     // * Date: 7/17/2024                                                     *
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-template <typename K, typename V>
-std::string HashTable<K, V>::encrypt(const std::string& str) const {
-    std::string encoded;
-    encoded.resize(((str.size() + 2) / 3) * 4);
-    
-    base64_encode(reinterpret_cast<const BYTE*>(str.data()), reinterpret_cast<BYTE*>(&encoded[0]), str.size(), 0);
-    return encoded;
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::migrateParallel(size_t threads) {
+    std::vector<Chain> staging = emptyLists(threads * threads); // staging[t * threads + p]: from t, for p
+    size_t first = migrated;
+    size_t pending = oldLists.size() - migrated;
+    size_t buckets = Lists.size();
+    detail::run_parallel(threads, [&](size_t t) {
+        for (size_t i = first + pending * t / threads; i < first + pending * (t + 1) / threads; ++i) {
+            auto& from = oldLists[i];
+            while (!from.empty()) {
+                auto& to = staging[t * threads + listsMod(from.front().hash) * threads / buckets];
+                to.splice(to.end(), from, from.begin());
+            }
+        }
+    });
+    detail::run_parallel(threads, [&](size_t p) {
+        for (size_t t = 0; t < threads; ++t) {
+            auto& from = staging[t * threads + p];
+            while (!from.empty()) {
+                auto& to = Lists[listsMod(from.front().hash)];
+                to.splice(to.end(), from, from.begin());
+            }
+        }
+    });
+    migrated = oldLists.size();
 }
 
     // ***********************************************************************
-    // * Function Name: decrypt                                              *
-    // * Description: Decrypts a base64 encoded string                       *
+    // * Function Name: workers                                              *
+    // * Description: Returns how many threads a rehash or bulk_build of     *
+    // *              the given number of entries uses: set_build_threads,   *
+    // *              or else the hardware threads, but no more than gives   *
+    // *              each parallel_grain entries, and at least one          *
     // *                                                                     *
     // * Parameter Description:                                              *
-    // * - const std::string& str: The string to be decrypted                *
-    // *                                                                     *
+    // * - size_t entries: The number of entries to move or build            *
     // * Date: 7/17/2024                                                     *
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-template <typename K, typename V>
-std::string HashTable<K, V>::decrypt(const std::string& str) const {
-    std::string decoded;
-    decoded.resize((str.size() * 3) / 4);
-    
-    base64_decode(reinterpret_cast<const BYTE*>(str.data()), reinterpret_cast<BYTE*>(&decoded[0]), str.size());
-    return decoded;
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+size_t HashTable<K, V, Layout, Alloc, Hash>::workers(size_t entries) const {
+    size_t threads = buildThreads ? buildThreads : std::thread::hardware_concurrency();
+    return std::max<size_t>(1, std::min(threads, entries / parallel_grain));
+}
+
+    // ***********************************************************************
+    // * Function Name: resetReducers                                        *
+    // * Description: Rebuilds the reducers of Lists and oldLists            *
+    // *              after either vector changes size                       *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::resetReducers() {
+    listsMod = detail::FastMod(Lists.size());
+    oldListsMod = detail::FastMod(oldLists.size());
+}
+
+    // ***********************************************************************
+    // * Function Name: emptyLists                                           *
+    // * Description: Returns n empty buckets that use this table's          *
+    // *              allocator. Each list is built from the allocator       *
+    // *              rather than copied, since a list copy may pick a       *
+    // *              different one                                          *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t n: The number of buckets                                   *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+std::vector<typename HashTable<K, V, Layout, Alloc, Hash>::Chain>
+HashTable<K, V, Layout, Alloc, Hash>::emptyLists(size_t n) const {
+    std::vector<Chain> lists;
+    lists.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        lists.emplace_back(alloc);
+    }
+    return lists;
+}
+
+    // ***********************************************************************
+    // * Function Name: copyLists                                            *
+    // * Description: Copies a vector of buckets into lists that use this    *
+    // *              table's allocator                                      *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::vector<std::list<...>>& from: The buckets              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+std::vector<typename HashTable<K, V, Layout, Alloc, Hash>::Chain>
+HashTable<K, V, Layout, Alloc, Hash>::copyLists(const std::vector<Chain>& from) const {
+    std::vector<Chain> lists;
+    lists.reserve(from.size());
+    for (const auto& selectedList : from) {
+        lists.emplace_back(selectedList.begin(), selectedList.end(), alloc);
+    }
+    return lists;
+}
+
+    // ***********************************************************************
+    // * Function Name: bucketAt                                             *
+    // * Description: Returns the list that holds the key with the given     *
+    // *              full hash code, or would hold it. While an incremental *
+    // *              rehash is running, keys of old buckets that have not   *
+    // *              moved yet are still found in oldLists                  *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t code: The unreduced hash of the key                        *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+const typename HashTable<K, V, Layout, Alloc, Hash>::Chain&
+HashTable<K, V, Layout, Alloc, Hash>::bucketAt(size_t code) const {
+    if (!oldLists.empty()) {
+        size_t oldIndex = oldListsMod(code);
+        if (oldIndex >= migrated) {
+            return oldLists[oldIndex];
+        }
+    }
+    return Lists[listsMod(code)];
+}
+
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+typename HashTable<K, V, Layout, Alloc, Hash>::Chain& HashTable<K, V, Layout, Alloc, Hash>::bucketAt(size_t code) {
+    // a bucket handed out for changing is first copied for a live snapshot,
+    // which only exists while no rehash is in progress
+    if (cow) {
+        preserve(listsMod(code) / cow_segment);
+    }
+    return const_cast<Chain&>(static_cast<const HashTable&>(*this).bucketAt(code));
+}
+
+    // ***********************************************************************
+    // * Function Name: insertEncoded                                        *
+    // * Description: Adds a pair whose value is already encoded and whose   *
+    // *              key is known to be absent, as when restoring a         *
+    // *              snapshot                                               *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::pair<K, V>&& kv: The key and encoded value                   *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::insertEncoded(std::pair<K, V>&& kv) {
+    size_t code = hasher(kv.first);
+    bucketAt(code).emplace_back(code, std::move(kv.first), std::move(kv.second));
+    ++currentSize;
+    filterAdd(code);
+    if (overloaded()) {
+        rehash(grownSize(Lists.size()));
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: rejects                                              *
+    // * Description: Returns true when the negative filter shows that no    *
+    // *              entry has the given hash code, counting the rejection. *
+    // *              With the filter off it never rejects                   *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t code: The unreduced hash of the key                        *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+bool HashTable<K, V, Layout, Alloc, Hash>::rejects(size_t code) const {
+    if (!filter.active() || filter.may_contain(code)) {
+        return false;
+    }
+    counters.filtered.count(true);
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: countFalsePositive                                   *
+    // * Description: Counts a key the filter let through that the buckets   *
+    // *              then did not hold                                      *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::countFalsePositive() const {
+    if (filter.active()) {
+        counters.filtered.count(false);
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: filterAdd                                            *
+    // * Description: Adds a new entry's hash code to the negative filter,   *
+    // *              rebuilding it twice as large once it passes its load   *
+    // *              limit                                                  *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t code: The unreduced hash of the key                        *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::filterAdd(size_t code) {
+    if (filter.active() && !filter.add(code)) {
+        rebuildFilter(2 * currentSize);
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: rebuildFilter                                        *
+    // * Description: Replaces the negative filter with one that has room for*
+    // *              at least the given number of keys and adds the stored  *
+    // *              hash code of every entry, so no key is hashed again    *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t keys: The keys the new filter should have room for         *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::rebuildFilter(size_t keys) {
+    CuckooFilter rebuilt(std::max(keys, currentSize));
+    for (size_t i = migrated; i < oldLists.size(); ++i) {
+        for (const auto& kv : oldLists[i]) {
+            rebuilt.add(kv.hash);
+        }
+    }
+    for (const auto& selectedList : Lists) {
+        for (const auto& kv : selectedList) {
+            rebuilt.add(kv.hash);
+        }
+    }
+    filter = std::move(rebuilt);
+}
+
+    // ***********************************************************************
+    // * Function Name: myhash                                               *
+    // * Description: Calculates the index in Lists of a key's bucket        *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const K& k: The key to hash.                                      *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+size_t HashTable<K, V, Layout, Alloc, Hash>::myhash(const K& k) const {
+    return listsMod(hasher(k));
+}
+
+    // ***********************************************************************
+    // * Function Name: fingerprint                                          *
+    // * Description: Hashes fingerprint_probe with the table's              *
+    // *              hasher. Snapshots carry it so that bucket indexes      *
+    // *              are only trusted by a table that hashes the            *
+    // *              same way                                               *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+uint64_t HashTable<K, V, Layout, Alloc, Hash>::fingerprint() const {
+    return static_cast<uint64_t>(detail::hash_view(hasher, fingerprint_probe));
+}
+
+// returns largest prime number <= n or zero if there is none. Odd candidates are tested
+// by trial division, which needs no sieve and works for any n.
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+unsigned long HashTable<K, V, Layout, Alloc, Hash>::prime_below(unsigned long n) const {
+    if (n <= 1) {
+        std::cerr << "** input too small \n";
+        return 0;
+    }
+    if (n <= 3) {
+        return n;
+    }
+    if (n % 2 == 0) {
+        --n;
+    }
+    for (;; n -= 2) {
+        bool prime = true;
+        for (unsigned long d = 3; d <= n / d; d += 2) {
+            if (n % d == 0) {
+                prime = false;
+                break;
+            }
+        }
+        if (prime) {
+            return n;
+        }
+    }
+}
+
+// returns the smallest entry of prime_sizes larger than n, or the last entry if there is none
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+unsigned long HashTable<K, V, Layout, Alloc, Hash>::next_prime(unsigned long n) const {
+    auto last = std::end(prime_sizes);
+    auto next = std::upper_bound(std::begin(prime_sizes), last, n);
+    if (next == last) {
+        --next;
+    }
+    return static_cast<unsigned long>(*next);
+}
+
+    // ***********************************************************************
+    // * Function Name: encrypt                                              *
+    // * Description: Encrypts a string using base64                         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::string& str:  string to be encrypted                   *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+std::string HashTable<K, V, Layout, Alloc, Hash>::encrypt(const std::string& str) const {
+    std::string encoded;
+    encoded.resize(((str.size() + 2) / 3) * 4);
+    
+    base64_encode(reinterpret_cast<const BYTE*>(str.data()), reinterpret_cast<BYTE*>(&encoded[0]), str.size(), 0);
+    return encoded;
+}
+
+    // ***********************************************************************
+    // * Function Name: decrypt                                              *
+    // * Description: Decrypts a base64 encoded string                       *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::string& str: The string to be decrypted                *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+std::string HashTable<K, V, Layout, Alloc, Hash>::decrypt(const std::string& str) const {
+    std::string decoded;
+    decoded.resize((str.size() * 3) / 4);
+    
+    base64_decode(reinterpret_cast<const BYTE*>(str.data()), reinterpret_cast<BYTE*>(&decoded[0]), str.size());
+    return decoded;
+}
+
+    // ***********************************************************************
+    // * Function Name: toStored                                             *
+    // * Description: Turns a value handed to the table into the form it is  *
+    // *              stored in: encrypted, or unchanged in raw mode         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - V value: The value to store                                       *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+V HashTable<K, V, Layout, Alloc, Hash>::toStored(V value) const {
+    if (storage == value_storage::raw) {
+        return value;
+    }
+    return encrypt(value);
+}
+
+    // ***********************************************************************
+    // * Function Name: appendEncoded                                        *
+    // * Description: Appends the encrypted form of a raw value to out,      *
+    // *              encoding in place so formatting a line allocates       *
+    // *              nothing. The bytes match what encrypt returns          *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::string& out: The text to append to                           *
+    // * - const std::string& value: The raw value                           *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::appendEncoded(std::string& out, const std::string& value) const {
+    detail::append_encoded(out, value);
+}
+
+    // ***********************************************************************
+    // * Function Name: decryptExact                                         *
+    // * Description: Inverts encrypt exactly. encrypt turns padding into    *
+    // *              NULs, which decrypt decodes as data; they are dropped  *
+    // *              first here so the original bytes come back unchanged   *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::string_view str: A value as encrypt returned it              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+std::string HashTable<K, V, Layout, Alloc, Hash>::decryptExact(std::string_view str) const {
+    while (!str.empty() && str.back() == '\0') {
+        str.remove_suffix(1);
+    }
+    std::string decoded;
+    decoded.resize((str.size() * 3) / 4);
+    size_t decodedLength = base64_decode(reinterpret_cast<const BYTE*>(str.data()), reinterpret_cast<BYTE*>(&decoded[0]), str.size());
+    decoded.resize(decodedLength);
+    return decoded;
+}
+
+    // ***********************************************************************
+    // * Function Name: write_snapshot                                       *
+    // * Description: Writes the table as a binary snapshot holding every   *
+    // *              pair with its bucket index and the encoded value. Keys *
+    // *              still waiting in oldLists are written with their       *
+    // *              bucket in the new vector. A raw table encodes each     *
+    // *              value as it goes, so snapshots load into either mode   *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* filename: The name of the file to write               *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+bool HashTable<K, V, Layout, Alloc, Hash>::write_snapshot(const char* filename) const {
+    static_assert(std::is_same<K, std::string>::value && std::is_same<V, std::string>::value,
+                  "snapshots hold string keys and values");
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) {
+        return false;
+    }
+    SnapshotWriter writer(out, snapshot_chained, Lists.size(), currentSize, fingerprint());
+    std::string encoded;
+    auto record = [&](uint64_t position, const std::pair<K, V>& kv) {
+        if (storage == value_storage::raw) {
+            encoded.clear();
+            appendEncoded(encoded, kv.second);
+            writer.record(position, kv.first, encoded);
+        } else {
+            writer.record(position, kv.first, kv.second);
+        }
+    };
+    for (size_t i = migrated; i < oldLists.size(); ++i) {
+        for (const auto& kv : oldLists[i]) {
+            record(listsMod(kv.hash), kv);
+        }
+    }
+    for (size_t i = 0; i < Lists.size(); ++i) {
+        for (const auto& kv : Lists[i]) {
+            record(i, kv);
+        }
+    }
+    return writer.finish();
+}
+
+    // ***********************************************************************
+    // * Function Name: load_snapshot                                        *
+    // * Description: Replaces the table with the contents of a snapshot.    *
+    // *              A chained snapshot taken with the same hasher is       *
+    // *              restored bucket by bucket with no encoding and no      *
+    // *              search for a bucket, though each key is hashed once    *
+    // *              for its entry;                                         *
+    // *              any other snapshot is re-hashed into a table sized for *
+    // *              its records. Values are never re-encoded; a raw table  *
+    // *              decodes them. A file that fails the header or checksum *
+    // *              check leaves the table unchanged; records that         *
+    // *              disagree with their header leave it empty              *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* filename: The name of the file to load from           *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+bool HashTable<K, V, Layout, Alloc, Hash>::load_snapshot(const char* filename) {
+    static_assert(std::is_same<K, std::string>::value && std::is_same<V, std::string>::value,
+                  "snapshots hold string keys and values");
+    SnapshotReader reader;
+    if (!reader.open(filename)) {
+        return false;
+    }
+    const SnapshotHeader& head = reader.header();
+    if (head.layout == snapshot_open_addressing && !reader.block(head.buckets)) {
+        return false;
+    }
+    bool direct = head.layout == snapshot_chained && reader.same_hash(fingerprint()) && head.buckets > 0;
+    clear();
+    Lists = emptyLists(direct ? head.buckets : next_prime(static_cast<unsigned long>(head.records / maxLoad)));
+    resetReducers();
+    if (filter.active() && head.records > filter.capacity()) {
+        rebuildFilter(head.records);
+    }
+    uint64_t position;
+    std::string_view key, value;
+    bool raw = storage == value_storage::raw;
+    while (reader.next(position, key, value)) {
+        if (!direct) {
+            insertEncoded({std::string(key), raw ? decryptExact(value) : std::string(value)});
+        } else if (position < Lists.size()) {
+            std::string k(key);
+            size_t code = hasher(k);
+            Lists[position].emplace_back(code, std::move(k), raw ? decryptExact(value) : std::string(value));
+            ++currentSize;
+            filterAdd(code);
+        } else {
+            break;
+        }
+    }
+    if (currentSize != head.records) {
+        clear();
+        return false;
+    }
+    return true;
 }
 
     // ***********************************************************************
@@ -427,9 +1506,482 @@ std::string HashTable<K, V>::decrypt(const std::string& str) const {
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-template <typename K, typename V>
-size_t HashTable<K, V>::size() const {
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+size_t HashTable<K, V, Layout, Alloc, Hash>::size() const {
     return currentSize;
 }
+
+    // ***********************************************************************
+    // * Function Name: set_incremental_rehash                               *
+    // * Description: Turns incremental rehashing on or off. When on, a      *
+    // *              rehash only allocates the new bucket vector and later  *
+    // *              inserts and removes each move rehash_step buckets, so  *
+    // *              no single insert pays for moving the whole table.      *
+    // *              Turning it off finishes any rehash in progress         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - bool on: true to spread rehashing across later operations         *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::set_incremental_rehash(bool on) {
+    incremental = on;
+    if (!incremental) {
+        migrate(oldLists.size(), true);
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: set_value_storage                                    *
+    // * Description: Switches between encoded and raw values, converting    *
+    // *              every value already in the table                       *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - value_storage mode: value_storage::encoded or raw                 *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::set_value_storage(value_storage mode) {
+    if (mode == storage) {
+        return;
+    }
+    preserveAll();
+    auto convert = [&](Chain& selectedList) {
+        for (auto& kv : selectedList) {
+            kv.second = mode == value_storage::raw ? decryptExact(kv.second) : encrypt(kv.second);
+        }
+    };
+    for (auto& selectedList : oldLists) {
+        convert(selectedList);
+    }
+    for (auto& selectedList : Lists) {
+        convert(selectedList);
+    }
+    storage = mode;
+}
+
+    // ***********************************************************************
+    // * Function Name: set_negative_filter                                  *
+    // * Description: Turns the negative filter on or off. Turning it on     *
+    // *              builds it from the entries already in the table; from  *
+    // *              then on every insert adds to it and every remove takes *
+    // *              from it, and a lookup of a key it has never seen ends  *
+    // *              without reading the buckets                            *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - bool on: true to keep the filter                                  *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::set_negative_filter(bool on) {
+    if (on) {
+        rebuildFilter(currentSize);
+    } else {
+        filter = CuckooFilter();
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: set_build_threads                                    *
+    // * Description: Sets how many threads a rehash that moves the whole    *
+    // *              table, and bulk_build, may use. 0, the default, uses   *
+    // *              as many as the hardware runs at once                   *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t threads: The most threads to use, or 0                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::set_build_threads(size_t threads) {
+    buildThreads = threads;
+}
+
+    // ***********************************************************************
+    // * Function Name: cow_snapshot                                         *
+    // * Description: Returns a point-in-time snapshot of the table. Any     *
+    // *              rehash in progress is finished first, and a snapshot   *
+    // *              still alive from an earlier call gets copies of every  *
+    // *              segment it has not been given yet. Otherwise it costs  *
+    // *              one flag per cow_segment buckets, and no entry is      *
+    // *              copied until the table changes                         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+std::shared_ptr<const typename HashTable<K, V, Layout, Alloc, Hash>::CowSnapshot>
+HashTable<K, V, Layout, Alloc, Hash>::cow_snapshot() {
+    migrate(oldLists.size());
+    preserveAll();
+    cow = std::make_shared<CowState>((Lists.size() + cow_segment - 1) / cow_segment);
+    std::shared_ptr<CowSnapshot> image(new CowSnapshot());
+    image->state = cow;
+    image->lists = &Lists;
+    image->buckets = Lists.size();
+    image->records = currentSize;
+    image->storage = storage;
+    image->hashFingerprint = fingerprint();
+    return image;
+}
+
+    // ***********************************************************************
+    // * Function Name: preserve                                             *
+    // * Description: Copies one segment of Lists for the live snapshot      *
+    // *              before the table changes it, unless it was copied      *
+    // *              already. If a reader of the snapshot holds the segment,*
+    // *              waits for it to finish. Once the snapshot is gone, lets*
+    // *              go of the shared state instead                         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t segment: The index of the segment in Lists                 *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::preserve(size_t segment) {
+    if (cow.use_count() == 1) {
+        // every read the snapshot made of Lists happened before it let go
+        std::atomic_thread_fence(std::memory_order_acquire);
+        cow.reset();
+        return;
+    }
+    auto& state = cow->states[segment];
+    for (;;) {
+        unsigned char seen = CowState::live;
+        if (state.compare_exchange_weak(seen, CowState::busy, std::memory_order_acquire)) {
+            auto& copy = cow->copies[segment];
+            size_t end = std::min(Lists.size(), (segment + 1) * cow_segment);
+            for (size_t i = segment * cow_segment; i < end; ++i) {
+                for (const auto& kv : Lists[i]) {
+                    copy.push_back({i, kv.first, kv.second});
+                }
+            }
+            state.store(CowState::preserved, std::memory_order_release);
+            return;
+        }
+        if (seen == CowState::preserved) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: preserveAll                                          *
+    // * Description: Copies every segment the live snapshot still reads from*
+    // *              Lists and lets go of the shared state, before a change *
+    // *              to the whole table such as a rehash or a clear         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::preserveAll() {
+    for (size_t segment = 0; cow && segment < cow->segments; ++segment) {
+        preserve(segment);
+    }
+    cow.reset();
+}
+
+    // ***********************************************************************
+    // * Function Name: size                                                 *
+    // * Description: Returns the number of entries in the snapshot          *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+size_t HashTable<K, V, Layout, Alloc, Hash>::CowSnapshot::size() const {
+    return records;
+}
+
+    // ***********************************************************************
+    // * Function Name: write                                                *
+    // * Description: Writes the snapshot as a password file, as the table's *
+    // *              write would have when the snapshot was taken, through a*
+    // *              temp file that is fsynced and renamed over filename    *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* filename: The name of the file to write               *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+bool HashTable<K, V, Layout, Alloc, Hash>::CowSnapshot::write(const char* filename) const {
+    AtomicFile outfile;
+    if (!outfile.open(filename)) {
+        return false;
+    }
+    bool written = writeText([&outfile](const std::string& chunk) {
+        return outfile.write(chunk.data(), chunk.size());
+    });
+    return written && outfile.commit();
+}
+
+    // ***********************************************************************
+    // * Function Name: write                                                *
+    // * Description: Writes the snapshot to an open stream, one pair per    *
+    // *              line                                                   *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::ostream& out: The stream to write to                         *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+bool HashTable<K, V, Layout, Alloc, Hash>::CowSnapshot::write(std::ostream& out) const {
+    writeText([&out](const std::string& chunk) {
+        out.write(chunk.data(), chunk.size());
+        return static_cast<bool>(out);
+    });
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+    // ***********************************************************************
+    // * Function Name: write_snapshot                                       *
+    // * Description: Writes the snapshot in the binary snapshot format, as  *
+    // *              the table's write_snapshot would have when it was taken*
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* filename: The name of the file to write               *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+bool HashTable<K, V, Layout, Alloc, Hash>::CowSnapshot::write_snapshot(const char* filename) const {
+    static_assert(std::is_same<K, std::string>::value && std::is_same<V, std::string>::value,
+                  "snapshots hold string keys and values");
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) {
+        return false;
+    }
+    SnapshotWriter writer(out, snapshot_chained, buckets, records, hashFingerprint);
+    std::string encoded;
+    for (size_t segment = 0; segment < state->segments; ++segment) {
+        visit(segment, [&](size_t position, const K& key, const V& value) {
+            if (storage == value_storage::raw) {
+                encoded.clear();
+                detail::append_encoded(encoded, value);
+                writer.record(position, key, encoded);
+            } else {
+                writer.record(position, key, value);
+            }
+        });
+    }
+    return writer.finish();
+}
+
+    // ***********************************************************************
+    // * Function Name: visit                                                *
+    // * Description: Calls visit(bucket, key, value) for each entry of one  *
+    // *              segment in bucket order: from the table while the      *
+    // *              segment is live, holding it busy so the table waits, or*
+    // *              from the copy the table made before changing it        *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t segment: The index of the segment                          *
+    // * - Visit visit: Called with each entry                               *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+template <typename Visit>
+void HashTable<K, V, Layout, Alloc, Hash>::CowSnapshot::visit(size_t segment, Visit visit) const {
+    auto& flag = state->states[segment];
+    for (;;) {
+        unsigned char seen = CowState::live;
+        if (flag.compare_exchange_weak(seen, CowState::busy, std::memory_order_acquire)) {
+            size_t end = std::min(buckets, (segment + 1) * cow_segment);
+            for (size_t i = segment * cow_segment; i < end; ++i) {
+                for (const auto& kv : (*lists)[i]) {
+                    visit(i, kv.first, kv.second);
+                }
+            }
+            flag.store(CowState::live, std::memory_order_release);
+            return;
+        }
+        if (seen == CowState::preserved) {
+            for (const auto& record : state->copies[segment]) {
+                visit(record.bucket, record.key, record.value);
+            }
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: writeText                                            *
+    // * Description: Formats the snapshot as "key value" lines, a chunk at a*
+    // *              time on several threads, in the order of the table's   *
+    // *              writeText                                              *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - Emit emit: Called with each chunk, returns false to stop          *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+template <typename Emit>
+bool HashTable<K, V, Layout, Alloc, Hash>::CowSnapshot::writeText(Emit emit) const {
+    auto format = [&](size_t begin, size_t end, std::string& chunk) {
+        for (size_t segment = begin / cow_segment; segment * cow_segment < end; ++segment) {
+            visit(segment, [&](size_t, const K& key, const V& value) {
+                detail::append_text(chunk, key);
+                chunk += ' ';
+                if (storage == value_storage::raw) {
+                    detail::append_encoded(chunk, value);
+                } else {
+                    detail::append_text(chunk, value);
+                }
+                chunk += '\n';
+            });
+        }
+    };
+    return detail::format_chunks(buckets, format, emit);
+}
+
+    // ***********************************************************************
+    // * Function Name: stats                                                *
+    // * Description: Reports the table's shape, its rehash history and how  *
+    // *              often its operations found their keys. The counters    *
+    // *              cost next to nothing; the shape is measured by         *
+    // *              walking every bucket when stats() is called            *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+TableStats HashTable<K, V, Layout, Alloc, Hash>::stats() const {
+    TableStats stats;
+    counters.report(stats);
+    stats.size = currentSize;
+    stats.buckets = Lists.size();
+    stats.load_factor = static_cast<double>(currentSize) / Lists.size();
+    stats.bytes = (Lists.capacity() + oldLists.capacity()) * sizeof(Chain) + filter.bytes();
+    stats.filter_bytes = filter.bytes();
+    auto measure = [&stats](const Chain& selectedList) {
+        size_t length = 0;
+        for (const auto& kv : selectedList) {
+            // a list node is the entry plus its two links
+            stats.bytes += sizeof(kv) + 2 * sizeof(void*) + detail::heap_bytes(kv.first) + detail::heap_bytes(kv.second);
+            ++length;
+        }
+        detail::add_to_histogram(stats.chain_lengths, length);
+        stats.max_probe = std::max(stats.max_probe, length);
+    };
+    for (size_t i = migrated; i < oldLists.size(); ++i) {
+        measure(oldLists[i]);
+    }
+    for (const auto& selectedList : Lists) {
+        measure(selectedList);
+    }
+    return stats;
+}
+
+    // ***********************************************************************
+    // * Function Name: reserve                                              *
+    // * Description: Makes room for n entries with a single rehash, to the  *
+    // *              bucket count that inserting them one at a time would   *
+    // *              have grown the table to                                *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t n: The number of entries to make room for                  *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+void HashTable<K, V, Layout, Alloc, Hash>::reserve(size_t n) {
+    size_t buckets = Lists.size();
+    while (n > buckets * maxLoad) {
+        size_t grown = grownSize(buckets);
+        if (grown <= buckets) {
+            break;
+        }
+        buckets = grown;
+    }
+    if (buckets > Lists.size()) {
+        rehash(buckets);
+    }
+    if (filter.active() && n > filter.capacity()) {
+        rebuildFilter(n);
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: set_max_load_factor                                  *
+    // * Description: Sets how many entries per bucket the table holds       *
+    // *              before it grows, and grows it now if it already holds  *
+    // *              more. Returns false and leaves the table alone for a   *
+    // *              factor that is not positive                            *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - double factor: Entries per bucket                                 *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+bool HashTable<K, V, Layout, Alloc, Hash>::set_max_load_factor(double factor) {
+    if (!(factor > 0)) {
+        std::cerr << "** max load factor must be positive\n";
+        return false;
+    }
+    maxLoad = factor;
+    reserve(currentSize);
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: set_growth_factor                                    *
+    // * Description: Sets how many times larger the table becomes each      *
+    // *              time it grows. Powers of two step along prime_sizes    *
+    // *              and other factors go to the largest prime at or below  *
+    // *              the target, so 3 grows about threefold. Returns false  *
+    // *              and leaves the table alone for a factor not above 1    *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - double factor: The growth factor                                  *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V, typename Layout, typename Alloc, typename Hash>
+bool HashTable<K, V, Layout, Alloc, Hash>::set_growth_factor(double factor) {
+    if (!(factor > 1)) {
+        std::cerr << "** growth factor must be above 1\n";
+        return false;
+    }
+    growth = factor;
+    return true;
+}
 } 
 #endif 
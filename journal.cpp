@@ -0,0 +1,380 @@
+#include "journal.h"
+#include "snapshot.h"
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cop4530 {
+
+namespace {
+
+// crc32c, op, key length, value length
+const size_t record_header = 4 + 1 + 4 + 4;
+
+// fills in the header of a record, its crc covering the key and value too
+void make_header(char* header, JournalOp op, std::string_view key, std::string_view value) {
+    uint32_t keyLength = static_cast<uint32_t>(key.size());
+    uint32_t valueLength = static_cast<uint32_t>(value.size());
+    header[4] = static_cast<char>(op);
+    std::memcpy(header + 5, &keyLength, 4);
+    std::memcpy(header + 9, &valueLength, 4);
+    uint32_t crc = crc32c(0, header + 4, record_header - 4);
+    crc = crc32c(crc, key.data(), key.size());
+    crc = crc32c(crc, value.data(), value.size());
+    std::memcpy(header, &crc, 4);
+}
+
+}
+
+    // ***********************************************************************
+    // * Function Name: Journal                                              *
+    // * Description: Constructor, creates a journal with no file open       *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+Journal::Journal()
+    : fd(-1), appended(0), durable(0), flushing(false), failed(false), stopping(false) {}
+
+    // ***********************************************************************
+    // * Function Name: ~Journal                                             *
+    // * Description: Destructor, writes out buffered records and closes     *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+Journal::~Journal() {
+    close();
+}
+
+    // ***********************************************************************
+    // * Function Name: open                                                 *
+    // * Description: Opens filename for appending, creating it if needed.   *
+    // *              A torn record left at the end by a crash is cut off    *
+    // *              first so new records follow the last intact one. An    *
+    // *              existing journal that cannot be read fails the open    *
+    // *              instead                                                *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* filename: The journal file                            *
+    // * - const JournalOptions& options: When records reach the disk        *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool Journal::open(const char* filename, const JournalOptions& opts) {
+    close();
+    int handle = ::open(filename, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (handle < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(handle, &info) != 0) {
+        ::close(handle);
+        return false;
+    }
+    // only records that were read and found torn may be cut; a journal that
+    // cannot be read is refused rather than truncated
+    size_t intact = 0;
+    if (info.st_size > 0) {
+        MappedFile existing;
+        if (!existing.open(filename)) {
+            ::close(handle);
+            return false;
+        }
+        intact = scan(existing, [](JournalOp, std::string_view, std::string_view) {});
+    }
+    if (static_cast<size_t>(info.st_size) != intact && ftruncate(handle, static_cast<off_t>(intact)) != 0) {
+        ::close(handle);
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    fd = handle;
+    options = opts;
+    pending.clear();
+    appended = durable = 0;
+    flushing = failed = stopping = false;
+    if (options.syncPolicy == JournalSync::interval) {
+        flusher = std::thread(&Journal::flushLoop, this);
+    }
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: close                                                *
+    // * Description: Stops the background flusher, writes out whatever is  *
+    // *              still buffered and closes the file                     *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void Journal::close() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (fd < 0) {
+            return;
+        }
+        stopping = true;
+    }
+    committed.notify_all();
+    if (flusher.joinable()) {
+        flusher.join();
+    }
+    std::unique_lock<std::mutex> held(lock);
+    committed.wait(held, [this] { return !flushing; });
+    if (!pending.empty() && !failed) {
+        flushLocked(held, options.syncPolicy != JournalSync::never);
+    }
+    ::close(fd);
+    fd = -1;
+}
+
+    // ***********************************************************************
+    // * Function Name: is_open                                              *
+    // * Description: Returns whether a journal file is open                 *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool Journal::is_open() const {
+    return fd >= 0;
+}
+
+    // ***********************************************************************
+    // * Function Name: append                                               *
+    // * Description: Adds one record. Under the always policy the caller    *
+    // *              either waits for the fsync already running and then    *
+    // *              commits everything queued behind it, or is committed   *
+    // *              by another caller doing so                             *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - JournalOp op: put, erase or clear                                 *
+    // * - std::string_view key: The key changed                             *
+    // * - std::string_view value: The new value of a put                    *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool Journal::append(JournalOp op, std::string_view key, std::string_view value) {
+    char header[record_header];
+    make_header(header, op, key, value);
+
+    std::unique_lock<std::mutex> held(lock);
+    if (fd < 0 || failed) {
+        return false;
+    }
+    pending.append(header, record_header);
+    pending.append(key.data(), key.size());
+    pending.append(value.data(), value.size());
+    uint64_t mine = ++appended;
+
+    switch (options.syncPolicy) {
+    case JournalSync::always:
+        while (durable < mine && !failed) {
+            if (!flushing) {
+                flushLocked(held, true);
+            } else {
+                committed.wait(held);
+            }
+        }
+        return durable >= mine;
+    case JournalSync::interval:
+        if (pending.size() >= options.groupBytes) {
+            committed.notify_all();
+        }
+        return true;
+    case JournalSync::never:
+        if (pending.size() >= options.groupBytes && !flushing) {
+            return flushLocked(held, false);
+        }
+        return true;
+    }
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: stage                                                *
+    // * Description: Queues one record of a batch without waiting for it    *
+    // *              to reach the disk. Once groupBytes are queued they     *
+    // *              are written, but not fsynced; commit() then makes      *
+    // *              the whole batch durable at once                        *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - JournalOp op: put, erase or clear                                 *
+    // * - std::string_view key: The key changed                             *
+    // * - std::string_view value: The new value of a put                    *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool Journal::stage(JournalOp op, std::string_view key, std::string_view value) {
+    char header[record_header];
+    make_header(header, op, key, value);
+
+    std::unique_lock<std::mutex> held(lock);
+    if (fd < 0 || failed) {
+        return false;
+    }
+    pending.append(header, record_header);
+    pending.append(key.data(), key.size());
+    pending.append(value.data(), value.size());
+    ++appended;
+    if (pending.size() >= options.groupBytes && !flushing) {
+        return flushLocked(held, false);
+    }
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: commit                                               *
+    // * Description: Makes the records staged so far as durable as          *
+    // *              append() would have made them: under the always        *
+    // *              policy they are written and fsynced together, and      *
+    // *              under the others it only reports whether the journal   *
+    // *              has failed                                             *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool Journal::commit() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (fd < 0 || failed) {
+            return false;
+        }
+        if (options.syncPolicy != JournalSync::always) {
+            return true;
+        }
+    }
+    return sync();
+}
+
+    // ***********************************************************************
+    // * Function Name: sync                                                 *
+    // * Description: Writes and fsyncs every record appended so far         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool Journal::sync() {
+    std::unique_lock<std::mutex> held(lock);
+    if (fd < 0) {
+        return false;
+    }
+    committed.wait(held, [this] { return !flushing; });
+    return !failed && flushLocked(held, true);
+}
+
+    // ***********************************************************************
+    // * Function Name: flushLocked                                          *
+    // * Description: Takes the buffered records and writes them, with the   *
+    // *              lock released so appenders can queue the next group    *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::unique_lock<std::mutex>& held: The held journal lock         *
+    // * - bool fsyncNow: Whether to fdatasync after the write               *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool Journal::flushLocked(std::unique_lock<std::mutex>& held, bool fsyncNow) {
+    flushing = true;
+    std::string batch;
+    batch.swap(pending);
+    uint64_t upto = appended;
+    held.unlock();
+    bool ok = write_all(fd, batch.data(), batch.size()) && (!fsyncNow || fdatasync(fd) == 0);
+    held.lock();
+    flushing = false;
+    if (!ok) {
+        failed = true;
+    } else if (fsyncNow || options.syncPolicy == JournalSync::never) {
+        // staged records written without an fsync are not yet durable
+        durable = upto;
+    }
+    committed.notify_all();
+    return ok;
+}
+
+    // ***********************************************************************
+    // * Function Name: flushLoop                                            *
+    // * Description: Body of the interval policy's background thread        *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void Journal::flushLoop() {
+    std::unique_lock<std::mutex> held(lock);
+    while (!stopping) {
+        committed.wait_for(held, std::chrono::milliseconds(options.intervalMs), [this] {
+            return stopping || pending.size() >= options.groupBytes;
+        });
+        if (!pending.empty() && !flushing && !failed) {
+            flushLocked(held, true);
+        }
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: decode                                               *
+    // * Description: Parses the record at p. Fails when the record is cut   *
+    // *              short, names an unknown operation or fails its CRC     *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* p: The start of the record                            *
+    // * - size_t n: The bytes available from p                              *
+    // * - size_t& used: Set to the length of the record                     *
+    // * - JournalOp& op: Set to the record's operation                      *
+    // * - std::string_view& key: Set to the key bytes                       *
+    // * - std::string_view& value: Set to the value bytes                   *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool Journal::decode(const char* p, size_t n, size_t& used, JournalOp& op,
+                     std::string_view& key, std::string_view& value) {
+    if (n < record_header) {
+        return false;
+    }
+    uint32_t crc, keyLength, valueLength;
+    std::memcpy(&crc, p, 4);
+    std::memcpy(&keyLength, p + 5, 4);
+    std::memcpy(&valueLength, p + 9, 4);
+    size_t length = record_header + static_cast<size_t>(keyLength) + valueLength;
+    if (n < length || crc32c(0, p + 4, length - 4) != crc) {
+        return false;
+    }
+    op = static_cast<JournalOp>(p[4]);
+    if (op != JournalOp::put && op != JournalOp::erase && op != JournalOp::clear) {
+        return false;
+    }
+    key = std::string_view(p + record_header, keyLength);
+    value = std::string_view(p + record_header + keyLength, valueLength);
+    used = length;
+    return true;
+}
+
+}
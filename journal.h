@@ -0,0 +1,112 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "mappedfile.h"
+
+namespace cop4530 {
+
+// When appended records reach the disk.
+//   always    append() returns once its record is fsynced. Appenders that
+//             arrive while an fsync is running are committed together by
+//             the next one (group commit).
+//   interval  a background thread writes and fsyncs every intervalMs.
+//   never     records are written once groupBytes are buffered, on sync()
+//             and on close(), and the kernel decides when they reach disk.
+enum class JournalSync { always, interval, never };
+
+struct JournalOptions {
+    JournalSync syncPolicy = JournalSync::always;
+    unsigned intervalMs = 10;
+    size_t groupBytes = 64 * 1024;
+};
+
+// Journal operations. All are absolute, so replaying a journal over a
+// table that already holds some prefix of it gives the same final table.
+// clear empties the table and has no key or value.
+enum class JournalOp : uint8_t { put = 1, erase = 2, clear = 3 };
+
+// Append-only log of table mutations. Each record is
+//   crc32c  uint32 over the rest of the record
+//   op      uint8
+//   lengths uint32 key length, uint32 value length
+//   bytes   key, then value
+// A torn record at the end of the file, left by a crash mid-append, is
+// dropped by replay() and cut off by the next open().
+class Journal {
+public:
+    Journal();
+    ~Journal();
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    bool open(const char* filename, const JournalOptions& options = JournalOptions());
+    void close();
+    bool is_open() const;
+    bool append(JournalOp op, std::string_view key, std::string_view value = std::string_view());
+    bool sync();
+
+    // Batches: stage() queues records without waiting on the disk and one
+    // commit() then makes them all durable, with a single fdatasync under
+    // the always policy, where one append() per record would pay one each.
+    bool stage(JournalOp op, std::string_view key, std::string_view value = std::string_view());
+    bool commit();
+
+    // Calls apply(op, key, value) for each intact record of filename in
+    // order. Returns the byte length of the intact prefix; a missing file
+    // has length 0.
+    template <typename F>
+    static size_t replay(const char* filename, F apply);
+
+private:
+    int fd;
+    JournalOptions options;
+    std::mutex lock;
+    std::condition_variable committed;
+    std::string pending;       // encoded records not yet written
+    uint64_t appended;         // records handed to append()
+    uint64_t durable;          // records written (and fsynced, unless never)
+    bool flushing;             // a thread is writing outside the lock
+    bool failed;
+    bool stopping;
+    std::thread flusher;
+    bool flushLocked(std::unique_lock<std::mutex>& held, bool fsyncNow);
+    void flushLoop();
+    static bool decode(const char* p, size_t n, size_t& used, JournalOp& op,
+                       std::string_view& key, std::string_view& value);
+    template <typename F>
+    static size_t scan(const MappedFile& file, F apply);
+};
+
+template <typename F>
+size_t Journal::replay(const char* filename, F apply) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        return 0;
+    }
+    return scan(file, apply);
+}
+
+// replay() of a file already mapped
+template <typename F>
+size_t Journal::scan(const MappedFile& file, F apply) {
+    size_t offset = 0;
+    size_t used;
+    JournalOp op;
+    std::string_view key, value;
+    while (decode(file.data() + offset, file.size() - offset, used, op, key, value)) {
+        apply(op, key, value);
+        offset += used;
+    }
+    return offset;
+}
+
+}
+
+#endif
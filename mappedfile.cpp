@@ -0,0 +1,442 @@
+#include "mappedfile.h"
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace cop4530 {
+
+namespace {
+
+bool sync_path(const char* path, int flags) {
+    int fd = ::open(path, flags);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+}
+
+    // ***********************************************************************
+    // * Function Name: MappedFile                                           *
+    // * Description: Constructor, creates a MappedFile with nothing open    *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+MappedFile::MappedFile() : bytes(nullptr), length(0), opened(false) {}
+
+    // ***********************************************************************
+    // * Function Name: MappedFile                                           *
+    // * Description: Constructor, maps the named file. Check is_open to see *
+    // *              whether it succeeded                                   *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* filename: The file to map                             *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+MappedFile::MappedFile(const char* filename) : MappedFile() {
+    open(filename);
+}
+
+    // ***********************************************************************
+    // * Function Name: ~MappedFile                                          *
+    // * Description: Destructor, unmaps the file                            *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+MappedFile::~MappedFile() {
+    close();
+}
+
+    // ***********************************************************************
+    // * Function Name: open                                                 *
+    // * Description: Maps the whole file read-only, closing any file that  *
+    // *              was open before. The kernel is told the mapping will   *
+    // *              be read front to back so it reads ahead aggressively   *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* filename: The file to map                             *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool MappedFile::open(const char* filename) {
+    close();
+    int fd = ::open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length > 0) {
+        void* map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        if (map == MAP_FAILED) {
+            ::close(fd);
+            length = 0;
+            return false;
+        }
+        madvise(map, length, MADV_SEQUENTIAL);
+        bytes = static_cast<const char*>(map);
+    }
+    // the mapping keeps the file alive on its own
+    ::close(fd);
+    opened = true;
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: close                                                *
+    // * Description: Unmaps the file if one is open                         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void MappedFile::close() {
+    if (bytes) {
+        munmap(const_cast<char*>(bytes), length);
+    }
+    bytes = nullptr;
+    length = 0;
+    opened = false;
+}
+
+    // ***********************************************************************
+    // * Function Name: is_open                                              *
+    // * Description: Returns whether a file is mapped                       *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool MappedFile::is_open() const {
+    return opened;
+}
+
+    // ***********************************************************************
+    // * Function Name: data                                                 *
+    // * Description: Returns the first byte of the mapping                  *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+const char* MappedFile::data() const {
+    return bytes;
+}
+
+    // ***********************************************************************
+    // * Function Name: size                                                 *
+    // * Description: Returns the length of the file in bytes                *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+size_t MappedFile::size() const {
+    return length;
+}
+
+    // ***********************************************************************
+    // * Function Name: AtomicFile                                           *
+    // * Description: Constructor, creates an AtomicFile with nothing open   *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+AtomicFile::AtomicFile() : fd(-1), failed(false) {}
+
+    // ***********************************************************************
+    // * Function Name: ~AtomicFile                                          *
+    // * Description: Destructor, removes the temp file unless it was        *
+    // *              committed                                              *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+AtomicFile::~AtomicFile() {
+    discard();
+}
+
+    // ***********************************************************************
+    // * Function Name: open                                                 *
+    // * Description: Creates an empty temp file beside filename, named      *
+    // *              after it and this process, discarding any file that    *
+    // *              was open before. filename is not touched until commit  *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* filename: The file to replace                         *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool AtomicFile::open(const char* filename) {
+    discard();
+    target = filename;
+    temp = target + ".tmp." + std::to_string(getpid());
+    fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    failed = false;
+    return fd >= 0;
+}
+
+    // ***********************************************************************
+    // * Function Name: write                                                *
+    // * Description: Appends n bytes to the temp file. Once a write fails   *
+    // *              every later write and the commit fail too              *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* p: The bytes to write                                 *
+    // * - size_t n: The number of bytes                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool AtomicFile::write(const char* p, size_t n) {
+    if (fd < 0 || failed) {
+        return false;
+    }
+    failed = !write_all(fd, p, n);
+    return !failed;
+}
+
+    // ***********************************************************************
+    // * Function Name: commit                                               *
+    // * Description: Closes the temp file and moves it over the target      *
+    // *              with commit_file. Any failure removes the temp file    *
+    // *              and leaves the target as it was                        *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool AtomicFile::commit() {
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = !failed && ::close(fd) == 0;
+    fd = -1;
+    if (ok && commit_file(temp, target)) {
+        temp.clear();
+        return true;
+    }
+    discard();
+    return false;
+}
+
+    // ***********************************************************************
+    // * Function Name: discard                                              *
+    // * Description: Closes and removes the temp file if one is still open  *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void AtomicFile::discard() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    if (!temp.empty()) {
+        std::remove(temp.c_str());
+        temp.clear();
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: write_all                                            *
+    // * Description: Writes every byte, retrying short writes and writes    *
+    // *              interrupted by a signal                                *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - int fd: The file to write to                                      *
+    // * - const char* p: The bytes to write                                 *
+    // * - size_t n: The number of bytes                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool write_all(int fd, const char* p, size_t n) {
+    while (n > 0) {
+        ssize_t written = ::write(fd, p, n);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += written;
+        n -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: commit_file                                          *
+    // * Description: Replaces target with temp so that after a crash either *
+    // *              the old or the complete new file is found              *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::string& temp: The fully written new file               *
+    // * - const std::string& target: The file to replace                    *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool commit_file(const std::string& temp, const std::string& target) {
+    if (!sync_path(temp.c_str(), O_RDONLY) || std::rename(temp.c_str(), target.c_str()) != 0) {
+        return false;
+    }
+    size_t slash = target.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : target.substr(0, slash);
+    return sync_path(dir.c_str(), O_RDONLY | O_DIRECTORY);
+}
+
+    // ***********************************************************************
+    // * Function Name: count_lines                                          *
+    // * Description: Counts the lines of a mapped file: its newlines, plus  *
+    // *              one for a last line with no newline. memchr scans the  *
+    // *              bytes far faster than a load parses them               *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const MappedFile& file: The open file                             *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+size_t count_lines(const MappedFile& file) {
+    const char* p = file.data();
+    const char* end = p + file.size();
+    size_t lines = 0;
+    while (p < end) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        ++lines;
+        if (!newline) {
+            break;
+        }
+        p = newline + 1;
+    }
+    return lines;
+}
+
+    // ***********************************************************************
+    // * Function Name: split_words                                          *
+    // * Description: Splits a line on spaces, tabs and carriage returns,    *
+    // *              keeping views of up to max words. Returns the number   *
+    // *              of words, which may exceed max                         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::string_view line: The line to split                          *
+    // * - std::string_view* words: Room for max views                       *
+    // * - size_t max: The most words to keep                                *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+size_t split_words(std::string_view line, std::string_view* words, size_t max) {
+    size_t count = 0;
+    size_t i = 0;
+    while (i < line.size()) {
+        while (i < line.size() && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r')) {
+            ++i;
+        }
+        size_t start = i;
+        while (i < line.size() && line[i] != ' ' && line[i] != '\t' && line[i] != '\r') {
+            ++i;
+        }
+        if (i > start) {
+            if (count < max) {
+                words[count] = line.substr(start, i - start);
+            }
+            ++count;
+        }
+    }
+    return count;
+}
+
+    // ***********************************************************************
+    // * Function Name: classify_block                                       *
+    // * Description: Builds the whitespace and newline masks of 64 bytes.   *
+    // *              With SSE2 each 16 byte lane is compared against ' '    *
+    // *              and '\n' and range checked for '\t'..'\r' at once      *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* p: The first of the 64 bytes                          *
+    // * - uint64_t& space: Set to the whitespace mask                       *
+    // * - uint64_t& newline: Set to the newline mask                        *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void classify_block(const char* p, uint64_t& space, uint64_t& newline) {
+    space = 0;
+    newline = 0;
+#if defined(__SSE2__)
+    const __m128i blank = _mm_set1_epi8(' ');
+    const __m128i lf = _mm_set1_epi8('\n');
+    // adding 128 - '\t' moves '\t'..'\r' to -128..-124, the only bytes below -123
+    const __m128i bias = _mm_set1_epi8(static_cast<char>(128 - '\t'));
+    const __m128i limit = _mm_set1_epi8(-128 + 5);
+    for (int lane = 0; lane < 4; ++lane) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * lane));
+        __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(bytes, blank),
+                                  _mm_cmplt_epi8(_mm_add_epi8(bytes, bias), limit));
+        uint64_t wsBits = static_cast<uint32_t>(_mm_movemask_epi8(ws));
+        uint64_t lfBits = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, lf)));
+        space |= wsBits << (16 * lane);
+        newline |= lfBits << (16 * lane);
+    }
+#else
+    for (int i = 0; i < 64; ++i) {
+        char c = p[i];
+        if (c == ' ' || (c >= '\t' && c <= '\r')) {
+            space |= uint64_t(1) << i;
+        }
+        if (c == '\n') {
+            newline |= uint64_t(1) << i;
+        }
+    }
+#endif
+}
+
+}
@@ -0,0 +1,169 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+namespace cop4530 {
+
+// Read-only view of a whole file mapped into memory. The bytes stay valid
+// until the file is closed or the MappedFile is destroyed. An empty file
+// opens successfully with size() == 0.
+class MappedFile {
+public:
+    MappedFile();
+    explicit MappedFile(const char* filename);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const char* filename);
+    void close();
+    bool is_open() const;
+    const char* data() const;
+    size_t size() const;
+
+private:
+    const char* bytes;
+    size_t length;
+    bool opened;
+};
+
+// Write-only file that replaces its target atomically. Bytes go to a temp
+// file beside the target; commit() makes them durable and renames the temp
+// file into place, so after a crash the target holds either its old
+// contents or all of the new ones. A file that is never committed is
+// removed when closed.
+class AtomicFile {
+public:
+    AtomicFile();
+    ~AtomicFile();
+    AtomicFile(const AtomicFile&) = delete;
+    AtomicFile& operator=(const AtomicFile&) = delete;
+
+    bool open(const char* filename);
+    bool write(const char* p, size_t n);
+    bool commit();
+    void discard();
+
+private:
+    int fd;
+    bool failed;
+    std::string temp;
+    std::string target;
+};
+
+// Writes all n bytes at p to fd, retrying short and interrupted writes.
+bool write_all(int fd, const char* p, size_t n);
+
+// Makes temp durable and atomically puts it in target's place: fsyncs temp,
+// renames it over target and fsyncs the directory holding them.
+bool commit_file(const std::string& temp, const std::string& target);
+
+// Number of lines in file, counting a last line that has no newline. Loads
+// use it to size a table before they fill it.
+size_t count_lines(const MappedFile& file);
+
+// Splits line on spaces, tabs and carriage returns. Stores up to max of the
+// words in words, as views into line, and returns how many there were, so
+// a count above max means the line had too many.
+size_t split_words(std::string_view line, std::string_view* words, size_t max);
+
+// Classifies the 64 bytes at p: bit i of space is set when p[i] is
+// whitespace (space, \t, \n, \v, \f or \r) and bit i of newline when p[i]
+// is '\n'. Checks 16 bytes at a time with SSE2.
+void classify_block(const char* p, uint64_t& space, uint64_t& newline);
+
+// index of the lowest set bit of a non-zero mask
+inline unsigned lowest_set_bit(uint64_t mask) {
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#else
+    unsigned i = 0;
+    while (!(mask & 1u)) {
+        mask >>= 1;
+        ++i;
+    }
+    return i;
+#endif
+}
+
+// Calls record(first, second) for every line of file holding exactly two
+// whitespace separated fields. The views point into the mapping. Blank lines
+// are skipped; any other line is reported on std::cerr with its line number
+// and skipped. Returns the number of malformed lines.
+//
+// The text is classified 64 bytes at a time and only the bytes where a field
+// starts, a field ends or a line ends are visited, so the cost per line does
+// not depend on how long the fields are.
+template <typename F>
+size_t for_each_pair(const MappedFile& file, const char* filename, F record) {
+    const char* base = file.data();
+    size_t size = file.size();
+    size_t line = 1;
+    size_t malformed = 0;
+    size_t fields = 0;
+    size_t fieldStart = 0;
+    std::string_view found[2];
+
+    auto endField = [&](size_t pos) {
+        if (fields < 2) {
+            found[fields] = std::string_view(base + fieldStart, pos - fieldStart);
+        }
+        ++fields;
+    };
+    auto endLine = [&]() {
+        if (fields == 2) {
+            record(found[0], found[1]);
+        } else if (fields != 0) {
+            std::cerr << "** " << filename << ":" << line << ": expected a username and a password\n";
+            ++malformed;
+        }
+        fields = 0;
+        ++line;
+    };
+
+    char tail[64];
+    uint64_t carry = 1; // the byte before the file counts as whitespace
+    for (size_t offset = 0; offset < size; offset += 64) {
+        const char* block = base + offset;
+        if (size - offset < 64) {
+            // newline padding ends the last line and any field still open
+            std::memset(tail, '\n', sizeof(tail));
+            std::memcpy(tail, block, size - offset);
+            block = tail;
+        }
+        uint64_t space, newline;
+        classify_block(block, space, newline);
+        uint64_t flips = space ^ ((space << 1) | carry);
+        carry = space >> 63;
+        for (uint64_t events = flips | newline; events; events &= events - 1) {
+            unsigned bit = lowest_set_bit(events);
+            if (!((space >> bit) & 1)) {
+                fieldStart = offset + bit;
+                continue;
+            }
+            if ((flips >> bit) & 1) {
+                endField(offset + bit);
+            }
+            if ((newline >> bit) & 1) {
+                endLine();
+            }
+        }
+    }
+    if (size % 64 == 0) {
+        if (size != 0 && !carry) {
+            endField(size);
+        }
+        endLine();
+    }
+    return malformed;
+}
+
+}
+
+#endif
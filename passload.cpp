@@ -0,0 +1,303 @@
+// Load generator for passserverd. Each connection runs on its own thread in
+// a closed loop: it sends --pipeline requests at once, waits for all of
+// their answers, and starts again until --seconds have passed. Most requests
+// are f and m on the users 0 to --users minus 1, which must answer 1; the
+// other --write-percent are a then r on users private to the connection.
+// --populate first adds the users through the server; without it the
+// server must already hold them.
+//
+// Prints requests per second over all connections, the latency of a
+// pipelined batch at the 50th, 99th and 100th percentiles, and how many
+// answers were not the expected one.
+//
+// Build: make passload
+// Usage: passload [--port N] [--host ADDR] [--unix PATH] [--connections N] [--pipeline N]
+//                 [--seconds S] [--users N] [--write-percent P] [--populate]
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 4530;
+    std::string unixPath;
+    size_t connections = 4;
+    size_t pipeline = 32;
+    double seconds = 5;
+    size_t users = 100000;
+    unsigned writePercent = 5;
+    bool populate = false;
+};
+
+// What one connection did.
+struct Tally {
+    size_t requests = 0;
+    size_t wrong = 0;
+    std::vector<double> batchMicros;
+    bool failed = false;
+};
+
+static std::string userName(size_t i) {
+    return "user" + std::to_string(i);
+}
+
+static std::string password(size_t i) {
+    return "pw" + std::to_string(i * 2654435761u % 1000003);
+}
+
+static int connectTo(const Options& opt) {
+    int fd;
+    if (!opt.unixPath.empty()) {
+        sockaddr_un addr{};
+        if (opt.unixPath.size() >= sizeof(addr.sun_path)) {
+            std::cerr << "** Socket path too long\n";
+            return -1;
+        }
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, opt.unixPath.c_str(), opt.unixPath.size() + 1);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            return fd;
+        }
+    } else {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(opt.port));
+        inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr);
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            return fd;
+        }
+    }
+    std::cerr << "** Unable to connect: " << std::strerror(errno) << "\n";
+    if (fd >= 0) {
+        close(fd);
+    }
+    return -1;
+}
+
+static bool sendAll(int fd, const std::string& bytes) {
+    size_t sent = 0;
+    while (sent < bytes.size()) {
+        ssize_t put = send(fd, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+        if (put < 0 && errno == EINTR) {
+            continue;
+        }
+        if (put <= 0) {
+            return false;
+        }
+        sent += put;
+    }
+    return true;
+}
+
+// Reads until lines answers have arrived and returns them, one per entry.
+static bool readAnswers(int fd, size_t lines, std::string& pending, std::vector<std::string>& answers) {
+    answers.clear();
+    char buffer[64 * 1024];
+    size_t begin = 0;
+    for (;;) {
+        size_t newline;
+        while (answers.size() < lines && (newline = pending.find('\n', begin)) != std::string::npos) {
+            answers.emplace_back(pending, begin, newline - begin);
+            begin = newline + 1;
+        }
+        if (answers.size() == lines) {
+            pending.erase(0, begin);
+            return true;
+        }
+        ssize_t got = recv(fd, buffer, sizeof(buffer), 0);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        pending.append(buffer, got);
+    }
+}
+
+// Adds users [first, last) in pipelined batches; returns false if the
+// connection failed.
+static bool populate(const Options& opt, size_t first, size_t last) {
+    int fd = connectTo(opt);
+    if (fd < 0) {
+        return false;
+    }
+    std::string request;
+    std::string pending;
+    std::vector<std::string> answers;
+    bool ok = true;
+    for (size_t start = first; start < last && ok; start += 1000) {
+        size_t end = std::min(last, start + 1000);
+        request.clear();
+        for (size_t i = start; i < end; ++i) {
+            request += "a " + userName(i) + " " + password(i) + "\n";
+        }
+        ok = sendAll(fd, request) && readAnswers(fd, end - start, pending, answers);
+    }
+    close(fd);
+    return ok;
+}
+
+static void run(const Options& opt, size_t id, Tally& tally) {
+    int fd = connectTo(opt);
+    if (fd < 0) {
+        tally.failed = true;
+        return;
+    }
+    std::mt19937_64 rng(id + 1);
+    std::string request;
+    std::string pending;
+    std::vector<std::string> expected;
+    std::vector<std::string> answers;
+    size_t added = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(opt.seconds);
+    while (std::chrono::steady_clock::now() < deadline) {
+        request.clear();
+        expected.clear();
+        for (size_t i = 0; i < opt.pipeline; ++i) {
+            size_t r = rng();
+            if (r % 100 < opt.writePercent) {
+                // alternate adding and removing users of this run and connection alone
+                std::string own = "c" + std::to_string(getpid()) + "_" + std::to_string(id) + "_" + std::to_string(added / 2);
+                request += (added++ % 2 == 0 ? "a " + own + " pw\n" : "r " + own + "\n");
+                expected.push_back("1");
+            } else {
+                size_t user = (r >> 8) % opt.users;
+                if (r & 0x80) {
+                    request += "f " + userName(user) + "\n";
+                } else {
+                    request += "m " + userName(user) + " " + password(user) + "\n";
+                }
+                expected.push_back("1");
+            }
+        }
+        auto start = std::chrono::steady_clock::now();
+        if (!sendAll(fd, request) || !readAnswers(fd, expected.size(), pending, answers)) {
+            std::cerr << "** Connection " << id << " closed\n";
+            tally.failed = true;
+            break;
+        }
+        tally.batchMicros.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        tally.requests += expected.size();
+        for (size_t i = 0; i < expected.size(); ++i) {
+            tally.wrong += answers[i] != expected[i];
+        }
+    }
+    close(fd);
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+int main(int argc, char* argv[]) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--populate") {
+            opt.populate = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "** Missing value for " << arg << "\n";
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (arg == "--port") {
+            opt.port = std::atoi(value.c_str());
+        } else if (arg == "--host") {
+            opt.host = value;
+        } else if (arg == "--unix") {
+            opt.unixPath = value;
+        } else if (arg == "--connections") {
+            opt.connections = std::max<size_t>(1, std::strtoul(value.c_str(), nullptr, 10));
+        } else if (arg == "--pipeline") {
+            opt.pipeline = std::max<size_t>(1, std::strtoul(value.c_str(), nullptr, 10));
+        } else if (arg == "--seconds") {
+            opt.seconds = std::atof(value.c_str());
+        } else if (arg == "--users") {
+            opt.users = std::max<size_t>(1, std::strtoul(value.c_str(), nullptr, 10));
+        } else if (arg == "--write-percent") {
+            opt.writePercent = static_cast<unsigned>(std::min(100ul, std::strtoul(value.c_str(), nullptr, 10)));
+        } else {
+            std::cerr << "** Unknown option " << arg << "\n";
+            return 2;
+        }
+    }
+
+    if (opt.populate) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        std::atomic<bool> ok(true);
+        for (size_t c = 0; c < opt.connections; ++c) {
+            size_t first = opt.users * c / opt.connections;
+            size_t last = opt.users * (c + 1) / opt.connections;
+            threads.emplace_back([&, first, last] {
+                if (!populate(opt, first, last)) {
+                    ok = false;
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        if (!ok) {
+            return 1;
+        }
+        std::cerr << "added " << opt.users << " users in "
+                  << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s\n";
+    }
+
+    std::vector<Tally> tallies(opt.connections);
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t c = 0; c < opt.connections; ++c) {
+        threads.emplace_back(run, std::cref(opt), c, std::ref(tallies[c]));
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t requests = 0;
+    size_t wrong = 0;
+    bool failed = false;
+    std::vector<double> micros;
+    for (const auto& tally : tallies) {
+        requests += tally.requests;
+        wrong += tally.wrong;
+        failed = failed || tally.failed;
+        micros.insert(micros.end(), tally.batchMicros.begin(), tally.batchMicros.end());
+    }
+    std::sort(micros.begin(), micros.end());
+    std::cout << std::fixed << std::setprecision(1)
+              << "connections " << opt.connections << ", pipeline " << opt.pipeline << "\n"
+              << "requests " << requests << " in " << elapsed << " s, " << requests / elapsed << " per second\n"
+              << "batch latency us: p50 " << percentile(micros, 0.50) << ", p99 " << percentile(micros, 0.99)
+              << ", max " << (micros.empty() ? 0 : micros.back()) << "\n"
+              << "unexpected answers " << wrong << "\n";
+    return failed || wrong ? 1 : 0;
+}
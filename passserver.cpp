@@ -1,10 +1,96 @@
 #include "passserver.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <unordered_set>
+#include <unistd.h>
 
 namespace cop4530 {
 
+namespace {
+
+const char hashed_prefix[] = "$pbkdf2-sha256$";
+const size_t salt_bytes = 16;
+const size_t load_batch = 256; // users hashed side by side by load in hashed mode
+
+// The fields of a hashed password; salt and key are raw bytes
+struct Credential {
+    uint32_t iterations = 0;
+    std::string salt;
+    std::string key;
+};
+
+bool is_hashed(std::string_view stored) {
+    return stored.compare(0, sizeof(hashed_prefix) - 1, hashed_prefix) == 0;
+}
+
+std::string to_base64(std::string_view bytes) {
+    std::string text((bytes.size() + 2) / 3 * 4, '\0');
+    text.resize(base64_encode(bytes.data(), &text[0], bytes.size(), 0));
+    return text;
+}
+
+std::string from_base64(std::string_view text) {
+    std::string bytes(text.size() * 3 / 4 + 3, '\0');
+    bytes.resize(base64_decode(text.data(), &bytes[0], text.size()));
+    return bytes;
+}
+
+// Splits $pbkdf2-sha256$ITERATIONS$SALT$KEY; false if it is malformed
+bool parse_credential(std::string_view stored, Credential& credential) {
+    if (!is_hashed(stored)) {
+        return false;
+    }
+    stored.remove_prefix(sizeof(hashed_prefix) - 1);
+    size_t first = stored.find('$');
+    size_t second = first == std::string_view::npos ? first : stored.find('$', first + 1);
+    if (second == std::string_view::npos) {
+        return false;
+    }
+    auto parsed = std::from_chars(stored.data(), stored.data() + first, credential.iterations);
+    if (parsed.ec != std::errc() || parsed.ptr != stored.data() + first || credential.iterations == 0) {
+        return false;
+    }
+    credential.salt = from_base64(stored.substr(first + 1, second - first - 1));
+    credential.key = from_base64(stored.substr(second + 1));
+    return credential.key.size() == sha256_bytes;
+}
+
+std::string format_credential(uint32_t iterations, std::string_view salt, const unsigned char* key) {
+    return hashed_prefix + std::to_string(iterations) + "$" + to_base64(salt) + "$" +
+           to_base64(std::string_view(reinterpret_cast<const char*>(key), sha256_bytes));
+}
+
+std::string random_salt() {
+    std::random_device device;
+    std::string salt(salt_bytes, '\0');
+    for (size_t i = 0; i < salt_bytes; i += sizeof(uint32_t)) {
+        uint32_t word = device();
+        std::memcpy(&salt[i], &word, sizeof(word));
+    }
+    return salt;
+}
+
+// Compares every byte whatever the first difference, so the time taken
+// does not tell an attacker how much of a guess was right
+bool same_key(const unsigned char* key, const std::string& expected) {
+    unsigned char difference = 0;
+    for (size_t i = 0; i < sha256_bytes; ++i) {
+        difference |= key[i] ^ static_cast<unsigned char>(expected[i]);
+    }
+    return difference == 0;
+}
+
+}
+
     // ***********************************************************************
     // * Function Name: PassServer                                           *
-    // * Description: Constructor for the PassServer class                   *
+    // * Description: Constructor for the PassServer class. The table keeps  *
+    // *              the encrypted passwords as they are and encodes them   *
+    // *              again only when they are written out                   *
     // *                                                                     *
     // * Parameter Description:                                              *
     // * - size_t size: The initial size of the hash table                   *
@@ -13,8 +99,9 @@ namespace cop4530 {
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-PassServer::PassServer(size_t size) : table(size) {
-    
+PassServer::PassServer(size_t size)
+    : table(size, &arena), storage(password_storage::encoded), iterations(default_hash_iterations) {
+    table.set_value_storage(value_storage::raw);
 }
 
     // ***********************************************************************
@@ -29,12 +116,23 @@ PassServer::PassServer(size_t size) : table(size) {
     // * References: None                                                    *
     // ***********************************************************************
 PassServer::~PassServer() {
+    wait_for_compaction();
+    journal.close();
     table.clear();
 }
 
     // ***********************************************************************
     // * Function Name: load                                                 *
     // * Description: Loads user password pairs from a file into the         *
+    // *              table. The file is mapped, the table sized for its     *
+    // *              lines and each line split in place; malformed lines    *
+    // *              are reported and skipped. In hashed mode the users are *
+    // *              added in batches through addUser_many; otherwise       *
+    // *              the table is built in one bulk_build. In durable       *
+    // *              mode a clear record and the users are journaled        *
+    // *              first, with one commit for the whole load, or one      *
+    // *              per addUser_many batch in hashed mode, so recovery     *
+    // *              drops the users the load replaced                      *
     // *                                                                     *
     // * Parameter Description:                                              *
     // * - const char* filename: name of the file to load from               *
@@ -44,23 +142,70 @@ PassServer::~PassServer() {
     // * References: None                                                    *
     // ***********************************************************************
 bool PassServer::load(const char* filename) {
-    std::ifstream infile(filename);
-    if (!infile) {
+    MappedFile file(filename);
+    if (!file.is_open()) {
         return false;
     }
-     table.clear();
-    std::string user, password;
-    while (infile >> user >> password) {
-        addUser({user, password});
+    // the users the load replaces must not come back on recovery; the clear
+    // is committed together with the users that replace them
+    if (journal.is_open() && !journal.stage(JournalOp::clear, std::string_view())) {
+        return false;
+    }
+    table.clear();
+    if (cache) {
+        cache->clear();
+    }
+    table.reserve(count_lines(file));
+    if (storage == password_storage::hashed) {
+        std::vector<std::pair<std::string, std::string>> batch;
+        for_each_pair(file, filename, [this, &batch](std::string_view user, std::string_view password) {
+            batch.emplace_back(std::string(user), std::string(password));
+            if (batch.size() == load_batch) {
+                addUser_many(batch);
+                batch.clear();
+            }
+        });
+        addUser_many(batch);
+        return !journal.is_open() || journal.commit();
+    }
+    if (journal.is_open()) {
+        // every user reaches the journal, in one commit, before the table;
+        // as with addUser, the first line of a user wins
+        std::vector<std::pair<std::string, std::string>> users;
+        std::unordered_set<std::string_view> seen;
+        for_each_pair(file, filename, [this, &users, &seen](std::string_view user, std::string_view password) {
+            if (seen.insert(user).second) {
+                users.emplace_back(std::string(user), protect(std::string(password)));
+            }
+        });
+        for (const auto& kv : users) {
+            if (!journal.stage(JournalOp::put, kv.first, kv.second)) {
+                return false;
+            }
+        }
+        if (!journal.commit()) {
+            return false;
+        }
+        table.bulk_build(users.size(), [&users](size_t i) {
+            return std::move(users[i]);
+        });
+        return true;
     }
-    infile.close();
+    std::vector<std::pair<std::string_view, std::string_view>> users;
+    for_each_pair(file, filename, [&users](std::string_view user, std::string_view password) {
+        users.emplace_back(user, password);
+    });
+    table.bulk_build(users.size(), [this, &users](size_t i) {
+        return std::make_pair(std::string(users[i].first), protect(std::string(users[i].second)));
+    });
     return true;
 }
 
     // ***********************************************************************
     // * Function Name: addUser                                              *
-    // * Description: Adds a user password pair. Encrypts                    *
-    // *              the password before insertion                          *
+    // * Description: Adds a user password pair. Encrypts or hashes          *
+    // *              the password before insertion. In durable mode the     *
+    // *              addition is journaled before it is applied             *
     // *                                                                     *
     // * Parameter Description:                                              *
     // * - std::pair<std::string, std::string>& kv: The user-password pair to add*
@@ -70,7 +215,14 @@ bool PassServer::load(const char* filename) {
     // * References: None                                                    *
     // ***********************************************************************
 bool PassServer::addUser(std::pair<std::string, std::string>& kv) {
-    kv.second = encrypt(kv.second);
+    // a hash is too costly to derive for a user who is then turned away
+    if (storage == password_storage::hashed && table.contains(kv.first)) {
+        return false;
+    }
+    kv.second = protect(kv.second);
+    if (journal.is_open() && (table.contains(kv.first) || !log(JournalOp::put, kv.first, kv.second))) {
+        return false;
+    }
     return table.insert(kv);
 }
 
@@ -87,7 +239,14 @@ bool PassServer::addUser(std::pair<std::string, std::string>& kv) {
     // * References: None                                                    *
     // ***********************************************************************
 bool PassServer::addUser(std::pair<std::string, std::string>&& kv) {
-    kv.second = encrypt(kv.second);
+    // a hash is too costly to derive for a user who is then turned away
+    if (storage == password_storage::hashed && table.contains(kv.first)) {
+        return false;
+    }
+    kv.second = protect(kv.second);
+    if (journal.is_open() && (table.contains(kv.first) || !log(JournalOp::put, kv.first, kv.second))) {
+        return false;
+    }
     return table.insert(std::move(kv));
 }
 
@@ -96,13 +255,19 @@ bool PassServer::addUser(std::pair<std::string, std::string>&& kv) {
     // * Description: Removes a user from the PassServer                     *
     // *                                                                     *
     // * Parameter Description:                                              *
-    // * - const std::string& k: The username to remove                      *
+    // * - std::string_view k: The username to remove                        *
     // *                                                                     *
     // * Date: 7/17/2024                                                     *
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-bool PassServer::removeUser(const std::string& k) {
+bool PassServer::removeUser(std::string_view k) {
+    if (cache) {
+        cache->erase(k);
+    }
+    if (journal.is_open() && (!table.contains(k) || !log(JournalOp::erase, std::string(k)))) {
+        return false;
+    }
     return table.remove(k);
 }
 
@@ -127,12 +292,18 @@ bool PassServer::changePassword(const std::pair<std::string, std::string>& p, co
     if (newpassword == p.second) {
         return false;
     }
-    std::string encryptedOldPassword = encrypt(p.second);
-    if (!table.match({p.first, encryptedOldPassword})) {
+    if (!match(p)) {
         return false;
     }
-     table.remove(p.first);
-    return table.insert({p.first, encrypt(newpassword)});
+    std::string storedNewPassword = protect(newpassword);
+    if (journal.is_open() && !log(JournalOp::put, p.first, storedNewPassword)) {
+        return false;
+    }
+    if (cache) {
+        cache->erase(p.first);
+    }
+    table.remove(p.first);
+    return table.insert({p.first, storedNewPassword});
 }
 
     // ***********************************************************************
@@ -140,32 +311,242 @@ bool PassServer::changePassword(const std::pair<std::string, std::string>& p, co
     // * Description: Checks if a user exists                                *
     // *                                                                     *
     // * Parameter Description:                                              *
-    // * - const std::string& user: the username to find                     *
+    // * - std::string_view user: the username to find                       *
     // *                                                                     *
     // * Date: 7/17/2024                                                     *
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-bool PassServer::find(const std::string& user) const {
+bool PassServer::find(std::string_view user) const {
     return table.contains(user);
 }
 
+    // ***********************************************************************
+    // * Function Name: match                                                *
+    // * Description: Checks if a user exists with the given password,       *
+    // *              whichever way it was stored: the encrypted password    *
+    // *              is matched in the table, and failing that a hashed     *
+    // *              one is checked by verify(). A verify cache is asked    *
+    // *              first and told of each success                         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::pair<std::string, std::string>& kv: username and       *
+    // *                                                  password           *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool PassServer::match(const std::pair<std::string, std::string>& kv) const {
+    if (cache && cache->lookup(kv.first, kv.second)) {
+        return true;
+    }
+    // an encrypted password is checked in the table; only a hashed one needs verify()
+    bool matched = table.match({kv.first, encrypt(kv.second)});
+    if (!matched) {
+        std::string stored = table.getpassword(kv.first);
+        matched = is_hashed(stored) && verify(kv.second, stored);
+    }
+    if (matched && cache) {
+        cache->insert(kv.first, kv.second);
+    }
+    return matched;
+}
+
+    // ***********************************************************************
+    // * Function Name: find_many                                            *
+    // * Description: Checks which of a batch of users exist                 *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::vector<std::string>& users: the usernames to find      *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+std::vector<bool> PassServer::find_many(const std::vector<std::string>& users) const {
+    return table.contains_many(users);
+}
+
+    // ***********************************************************************
+    // * Function Name: match_many                                           *
+    // * Description: Checks a batch of username password pairs. With a      *
+    // *              verify cache, only the pairs it misses are checked     *
+    // *              by matchBatch                                          *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::vector<std::pair<std::string, std::string>>& kvs:      *
+    // *   the username password pairs to check                              *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+std::vector<bool> PassServer::match_many(const std::vector<std::pair<std::string, std::string>>& kvs) const {
+    if (!cache) {
+        return matchBatch(kvs);
+    }
+    std::vector<bool> matched(kvs.size());
+    std::vector<std::pair<std::string, std::string>> missed;
+    std::vector<size_t> positions;
+    for (size_t i = 0; i < kvs.size(); ++i) {
+        if (cache->lookup(kvs[i].first, kvs[i].second)) {
+            matched[i] = true;
+        } else {
+            missed.push_back(kvs[i]);
+            positions.push_back(i);
+        }
+    }
+    std::vector<bool> checked = matchBatch(missed);
+    for (size_t k = 0; k < missed.size(); ++k) {
+        if (checked[k]) {
+            matched[positions[k]] = true;
+            cache->insert(missed[k].first, missed[k].second);
+        }
+    }
+    return matched;
+}
+
+    // ***********************************************************************
+    // * Function Name: matchBatch                                           *
+    // * Description: Checks a batch of username password pairs against      *
+    // *              the table, whatever mode stored them. Encrypted        *
+    // *              passwords are matched in the table in one batch; the   *
+    // *              keys of the hashed users left over are derived side    *
+    // *              by side, grouped by their iteration counts             *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::vector<std::pair<std::string, std::string>>& kvs:      *
+    // *   the username password pairs to check                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+std::vector<bool> PassServer::matchBatch(const std::vector<std::pair<std::string, std::string>>& kvs) const {
+    std::vector<std::pair<std::string, std::string>> encrypted;
+    encrypted.reserve(kvs.size());
+    for (const auto& kv : kvs) {
+        encrypted.emplace_back(kv.first, encrypt(kv.second));
+    }
+    std::vector<bool> matched = table.match_many(encrypted);
+    std::vector<Credential> credentials(kvs.size());
+    std::vector<size_t> hashed;
+    for (size_t i = 0; i < kvs.size(); ++i) {
+        if (matched[i]) {
+            continue;
+        }
+        std::string stored = table.getpassword(kvs[i].first);
+        if (is_hashed(stored) && parse_credential(stored, credentials[i])) {
+            hashed.push_back(i);
+        }
+    }
+    // one batch per iteration count, which the lanes of a batch share
+    std::stable_sort(hashed.begin(), hashed.end(), [&credentials](size_t a, size_t b) {
+        return credentials[a].iterations < credentials[b].iterations;
+    });
+    std::vector<unsigned char> keys(hashed.size() * sha256_bytes);
+    std::vector<Pbkdf2Job> jobs;
+    jobs.reserve(hashed.size());
+    for (size_t k = 0; k < hashed.size(); ++k) {
+        jobs.push_back({kvs[hashed[k]].second, credentials[hashed[k]].salt, &keys[k * sha256_bytes]});
+    }
+    for (size_t begin = 0, end; begin < hashed.size(); begin = end) {
+        uint32_t count = credentials[hashed[begin]].iterations;
+        for (end = begin + 1; end < hashed.size() && credentials[hashed[end]].iterations == count; ++end) {
+        }
+        pbkdf2_sha256_many(&jobs[begin], end - begin, count);
+    }
+    for (size_t k = 0; k < hashed.size(); ++k) {
+        matched[hashed[k]] = same_key(&keys[k * sha256_bytes], credentials[hashed[k]].key);
+    }
+    return matched;
+}
+
+    // ***********************************************************************
+    // * Function Name: addUser_many                                         *
+    // * Description: Adds a batch of user password pairs. Encrypts the      *
+    // *              passwords of the users it will add, or in hashed mode  *
+    // *              derives their keys side by side. In durable mode       *
+    // *              they are journaled as one batch, with a single         *
+    // *              commit, before they are applied; if the journal        *
+    // *              fails, none of them are added                          *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::vector<std::pair<std::string, std::string>>& kvs:      *
+    // *   the user password pairs to add                                    *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+std::vector<bool> PassServer::addUser_many(const std::vector<std::pair<std::string, std::string>>& kvs) {
+    // the users insert_many will take: not in the table and first of their name in the batch
+    std::vector<size_t> added;
+    std::unordered_set<std::string_view> seen;
+    for (size_t i = 0; i < kvs.size(); ++i) {
+        if (!table.contains(kvs[i].first) && seen.insert(kvs[i].first).second) {
+            added.push_back(i);
+        }
+    }
+    std::vector<std::pair<std::string, std::string>> batch;
+    batch.reserve(added.size());
+    if (storage == password_storage::hashed) {
+        std::vector<std::string> salts;
+        for (size_t k = 0; k < added.size(); ++k) {
+            salts.push_back(random_salt());
+        }
+        std::vector<unsigned char> keys(added.size() * sha256_bytes);
+        std::vector<Pbkdf2Job> jobs;
+        jobs.reserve(added.size());
+        for (size_t k = 0; k < added.size(); ++k) {
+            jobs.push_back({kvs[added[k]].second, salts[k], &keys[k * sha256_bytes]});
+        }
+        pbkdf2_sha256_many(jobs.data(), jobs.size(), iterations);
+        for (size_t k = 0; k < added.size(); ++k) {
+            batch.emplace_back(kvs[added[k]].first, format_credential(iterations, salts[k], &keys[k * sha256_bytes]));
+        }
+    } else {
+        for (size_t i : added) {
+            batch.emplace_back(kvs[i].first, encrypt(kvs[i].second));
+        }
+    }
+    if (journal.is_open() && !batch.empty()) {
+        bool staged = true;
+        for (const auto& kv : batch) {
+            staged = staged && journal.stage(JournalOp::put, kv.first, kv.second);
+        }
+        if (!staged || !journal.commit()) {
+            batch.clear();
+        }
+    }
+    std::vector<bool> inserted(kvs.size(), false);
+    std::vector<bool> applied = table.insert_many(batch);
+    for (size_t k = 0; k < batch.size(); ++k) {
+        inserted[added[k]] = applied[k];
+    }
+    return inserted;
+}
+
     // ***********************************************************************
     // * Function Name: decodepw                                             *
-    // * Description: Finds and decrypts the password for a given user       *
+    // * Description: Finds and decrypts the password for a given user.      *
+    // *              A hashed password gives NOT AVAILABLE                  *
     // *                                                                     *
     // * Parameter Description:                                              *
-    // * - const std::string& user: The username to find                     *
+    // * - std::string_view user: The username to find                       *
     // *                                                                     *
     // * Date: 7/17/2024                                                     *
     // * Author: Dallas Toth                                                 *
     // * References: None                                                    *
     // ***********************************************************************
-std::string PassServer::decodepw(const std::string& user) const {
+std::string PassServer::decodepw(std::string_view user) const {
     auto encryptedPassword = table.getpassword(user);
     if (encryptedPassword == "NOT FOUND") {
         return "NOT FOUND";
     }
+    if (is_hashed(encryptedPassword)) {
+        return "NOT AVAILABLE";
+    }
     return decrypt(encryptedPassword);
 }
 
@@ -198,6 +579,22 @@ size_t PassServer::size() const {
     return table.size();
 }
 
+    // ***********************************************************************
+    // * Function Name: stats                                                *
+    // * Description: Returns the statistics of the table. The estimated     *
+    // *              bytes count list nodes at their own size, not the      *
+    // *              arena chunks they are carved from                      *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+TableStats PassServer::stats() const {
+    return table.stats();
+}
+
     // ***********************************************************************
     // * Function Name: write_to_file                                        *
     // * Description: Writes all user-password pairs in the PassServer to a  *
@@ -214,6 +611,283 @@ bool PassServer::write_to_file(const char* filename) const {
     return table.write(filename);
 }
 
+    // ***********************************************************************
+    // * Function Name: write_snapshot                                       *
+    // * Description: Writes a binary snapshot of the table that             *
+    // *              load_snapshot restores without re-encoding             *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* filename: The name of the file to write               *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool PassServer::write_snapshot(const char* filename) const {
+    return table.write_snapshot(filename);
+}
+
+    // ***********************************************************************
+    // * Function Name: load_snapshot                                        *
+    // * Description: Replaces all users with those of a snapshot written by *
+    // *              write_snapshot                                         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* filename: The name of the file to load from           *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool PassServer::load_snapshot(const char* filename) {
+    if (cache) {
+        cache->clear();
+    }
+    return table.load_snapshot(filename);
+}
+
+    // ***********************************************************************
+    // * Function Name: set_password_storage                                 *
+    // * Description: Chooses how passwords added from now on are kept.      *
+    // *              Passwords already in the table stay as they are        *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - password_storage mode: encoded or hashed                          *
+    // * - uint32_t iterations: PBKDF2 iterations of new hashes,             *
+    // *   at least 1                                                        *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void PassServer::set_password_storage(password_storage mode, uint32_t iterations) {
+    storage = mode;
+    this->iterations = std::max<uint32_t>(iterations, 1);
+}
+
+    // ***********************************************************************
+    // * Function Name: set_verify_cache                                     *
+    // * Description: Puts a cache of recent successful logins in front      *
+    // *              of match and match_many, or removes it                 *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t entries: The logins to remember, 0 for no cache            *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void PassServer::set_verify_cache(size_t entries) {
+    cache.reset(entries > 0 ? new VerifyCache(entries) : nullptr);
+}
+
+    // ***********************************************************************
+    // * Function Name: cache_stats                                          *
+    // * Description: Returns the verify cache counters, all zero when       *
+    // *              there is no cache                                      *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+CacheStats PassServer::cache_stats() const {
+    return cache ? cache->stats() : CacheStats();
+}
+
+    // ***********************************************************************
+    // * Function Name: set_negative_filter                                  *
+    // * Description: Turns the table's negative filter on or off            *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - bool on: true to filter lookups of absent users                   *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void PassServer::set_negative_filter(bool on) {
+    table.set_negative_filter(on);
+}
+
+    // ***********************************************************************
+    // * Function Name: snapshot                                             *
+    // * Description: Returns a copy-on-write image of the users as they are *
+    // *              now                                                    *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+std::shared_ptr<const PassServer::Snapshot> PassServer::snapshot() {
+    return table.cow_snapshot();
+}
+
+    // ***********************************************************************
+    // * Function Name: recover                                              *
+    // * Description: Rebuilds the table from the last snapshot and the      *
+    // *              journal, then journals every later change. A missing   *
+    // *              snapshot or journal counts as empty. If a compaction   *
+    // *              was cut short, its journal is replayed too and folded  *
+    // *              into a new snapshot before returning                   *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* snapshot: The snapshot file                           *
+    // * - const char* journal: The journal file                             *
+    // * - const JournalOptions& options: When journal records are synced    *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool PassServer::recover(const char* snapshot, const char* journalFile, const JournalOptions& options) {
+    wait_for_compaction();
+    journal.close();
+    snapshotPath = snapshot;
+    journalPath = journalFile;
+    journalOptions = options;
+    table.clear();
+    if (cache) {
+        cache->clear();
+    }
+    if (access(snapshot, F_OK) == 0 && !table.load_snapshot(snapshot)) {
+        return false;
+    }
+    std::string folding = journalPath + ".compacting";
+    bool interrupted = access(folding.c_str(), F_OK) == 0;
+    if (interrupted) {
+        replay(folding.c_str());
+    }
+    replay(journalFile);
+    if (interrupted && (!writeSnapshot() || std::remove(folding.c_str()) != 0)) {
+        return false;
+    }
+    return journal.open(journalFile, journalOptions);
+}
+
+    // ***********************************************************************
+    // * Function Name: compact                                              *
+    // * Description: Starts folding the journal into a new snapshot. The    *
+    // *              journal is set aside and a fresh one started, a        *
+    // *              copy-on-write snapshot of the table is taken, and a    *
+    // *              background thread writes it as the new snapshot and    *
+    // *              then drops the old journal. Until it finishes,         *
+    // *              recovery still replays the old journal, which is       *
+    // *              harmless because its records are absolute              *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool PassServer::compact() {
+    if (!journal.is_open()) {
+        return false;
+    }
+    wait_for_compaction();
+    std::string folding = journalPath + ".compacting";
+    // a journal left by a failed compaction holds changes no snapshot has yet
+    if (access(folding.c_str(), F_OK) == 0) {
+        return false;
+    }
+    journal.close();
+    if (std::rename(journalPath.c_str(), folding.c_str()) != 0) {
+        journal.open(journalPath.c_str(), journalOptions);
+        return false;
+    }
+    if (!journal.open(journalPath.c_str(), journalOptions)) {
+        return false;
+    }
+    // the image only reads the table's nodes, and the copies it is given are
+    // made with the default allocator, so the thread never touches the arena
+    std::shared_ptr<const Snapshot> image = table.cow_snapshot();
+    std::string snapshot = snapshotPath;
+    compactor = std::thread([image, snapshot, folding]() {
+        std::string temp = snapshot + ".tmp";
+        if (image->write_snapshot(temp.c_str()) && commit_file(temp, snapshot)) {
+            std::remove(folding.c_str());
+        }
+    });
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: wait_for_compaction                                  *
+    // * Description: Blocks until a running compaction has finished        *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void PassServer::wait_for_compaction() {
+    if (compactor.joinable()) {
+        compactor.join();
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: log                                                  *
+    // * Description: Appends one change to the journal                     *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - JournalOp op: put, erase or clear                                 *
+    // * - const std::string& user: The username changed                     *
+    // * - const std::string& value: The encrypted password of a put         *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool PassServer::log(JournalOp op, const std::string& user, const std::string& value) {
+    return journal.append(op, user, value);
+}
+
+    // ***********************************************************************
+    // * Function Name: replay                                               *
+    // * Description: Applies every intact record of a journal file          *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* filename: The journal to replay                       *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void PassServer::replay(const char* filename) {
+    Journal::replay(filename, [this](JournalOp op, std::string_view user, std::string_view value) {
+        if (op == JournalOp::clear) {
+            table.clear();
+            return;
+        }
+        table.remove(user);
+        if (op == JournalOp::put) {
+            table.insert({std::string(user), std::string(value)});
+        }
+    });
+}
+
+    // ***********************************************************************
+    // * Function Name: writeSnapshot                                        *
+    // * Description: Writes the snapshot in place of the old one, through a *
+    // *              temporary file so a crash never leaves it half written *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool PassServer::writeSnapshot() const {
+    std::string temp = snapshotPath + ".tmp";
+    return table.write_snapshot(temp.c_str()) && commit_file(temp, snapshotPath);
+}
+
     // ***********************************************************************
     // * Function Name: encrypt                                              *
     // * Description: Encrypts a string using base64 encoding                *
@@ -256,4 +930,52 @@ std::string PassServer::decrypt(const std::string& str) const {
     return decoded;
 }
 
+    // ***********************************************************************
+    // * Function Name: protect                                              *
+    // * Description: Turns a plaintext password into the form the table     *
+    // *              keeps: encrypt() in encoded mode, or a salted          *
+    // *              PBKDF2-HMAC-SHA256 hash in hashed mode                 *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::string& password: The plaintext password               *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+std::string PassServer::protect(const std::string& password) const {
+    if (storage == password_storage::encoded) {
+        return encrypt(password);
+    }
+    std::string salt = random_salt();
+    unsigned char key[sha256_bytes];
+    pbkdf2_sha256(password, salt, iterations, key, sizeof(key));
+    return format_credential(iterations, salt, key);
+}
+
+    // ***********************************************************************
+    // * Function Name: verify                                               *
+    // * Description: Checks a plaintext password against a stored one,      *
+    // *              hashed with the iterations it was stored with or       *
+    // *              encrypted                                              *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::string& password: The plaintext password               *
+    // * - const std::string& stored: The value in the table                 *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool PassServer::verify(const std::string& password, const std::string& stored) const {
+    if (!is_hashed(stored)) {
+        return encrypt(password) == stored;
+    }
+    Credential credential;
+    if (!parse_credential(stored, credential)) {
+        return false;
+    }
+    unsigned char key[sha256_bytes];
+    pbkdf2_sha256(password, credential.salt, credential.iterations, key, sizeof(key));
+    return same_key(key, credential.key);
+}
+
 } 
@@ -2,31 +2,113 @@
 #define PASSSERVER_H
 
 #include "hashtable.h"
+#include "arena.h"
 #include "base64.h"
+#include "journal.h"
+#include "sha256.h"
+#include "verifycache.h"
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace cop4530 {
 
+// How PassServer keeps passwords.
+//   encoded  base64, as it always has; decodepw recovers them.
+//   hashed   PBKDF2-HMAC-SHA256 with a random 16 byte salt per user, kept as
+//            $pbkdf2-sha256$ITERATIONS$SALT$KEY with SALT and KEY in base64.
+//            They cannot be recovered, so decodepw returns "NOT AVAILABLE".
+// Passwords are checked by the form they were stored in, whatever the mode,
+// so users stored in either mode, or recovered from a snapshot or journal
+// written in either, can still log in. In hashed mode an encoded user is
+// hashed on their next changePassword. load, match_many and addUser_many
+// derive the keys of a batch side by side in SIMD lanes (see
+// pbkdf2_sha256_many).
+enum class password_storage { encoded, hashed };
+static const uint32_t default_hash_iterations = 100000;
+
 class PassServer {
 public:
+    typedef HashTable<std::string, std::string, separate_chaining,
+                      ArenaAllocator<std::pair<std::string, std::string>>, fast_hash<std::string>> Table;
+    typedef Table::CowSnapshot Snapshot;
+
     PassServer(size_t size = 101);
     ~PassServer();
+    PassServer(const PassServer&) = delete;
+    PassServer& operator=(const PassServer&) = delete;
 
     bool load(const char* filename);
     bool addUser(std::pair<std::string, std::string>& kv);
     bool addUser(std::pair<std::string, std::string>&& kv);
-    bool removeUser(const std::string& k);
+    bool removeUser(std::string_view k);
     bool changePassword(const std::pair<std::string, std::string>& p, const std::string& newpassword);
-    bool find(const std::string& user) const;
-    std::string decodepw(const std::string& user) const;
+    bool find(std::string_view user) const;
+    bool match(const std::pair<std::string, std::string>& kv) const;
+    std::vector<bool> find_many(const std::vector<std::string>& users) const;
+    std::vector<bool> match_many(const std::vector<std::pair<std::string, std::string>>& kvs) const;
+    std::vector<bool> addUser_many(const std::vector<std::pair<std::string, std::string>>& kvs);
+    std::string decodepw(std::string_view user) const;
     void dump() const;
     size_t size() const;
+    TableStats stats() const;
     bool write_to_file(const char* filename) const;
+    bool write_snapshot(const char* filename) const;
+    bool load_snapshot(const char* filename);
+    void set_password_storage(password_storage mode, uint32_t iterations = default_hash_iterations);
+
+    // Optional VerifyCache of recent successful logins in front of match and
+    // match_many, so a user who logs in again with the same password skips
+    // the table and, in hashed mode, the key derivation. In encoded mode a
+    // hit is only somewhat cheaper than a match and a miss costs more, so it
+    // pays off there only when the cache holds most of the traffic. 0 entries
+    // turns it off. Every path that changes or drops passwords invalidates it.
+    void set_verify_cache(size_t entries);
+    CacheStats cache_stats() const;
+
+    // Optional negative filter on the table (see HashTable::set_negative_filter),
+    // so find, match and removeUser of a user who does not exist, the bulk of
+    // credential-stuffing traffic, answer without reading the buckets. Its
+    // rejections and false-positive rate are part of stats().
+    void set_negative_filter(bool on);
+
+    // A point-in-time image of the users (see HashTable::cow_snapshot). Its
+    // write() and write_snapshot() make the files write_to_file and
+    // write_snapshot would have made when it was taken, and may run on
+    // another thread while this PassServer keeps changing. compact() uses
+    // one, so a compaction no longer copies the table.
+    std::shared_ptr<const Snapshot> snapshot();
+
+    // Durable mode: recover() loads the snapshot, replays the journal and
+    // then logs every successful addUser, addUser_many, removeUser and
+    // changePassword to the journal before applying it. load() logs a clear
+    // and then each user it adds, so recovery drops the users it replaced.
+    // compact() folds the journal into a new snapshot on a background
+    // thread. load_snapshot() is not logged; call compact() after it.
+    bool recover(const char* snapshot, const char* journalFile, const JournalOptions& options = JournalOptions());
+    bool compact();
+    void wait_for_compaction();
 
 private:
-    HashTable<std::string, std::string> table;
+    Arena arena; // holds the table's nodes, so it is declared first and destroyed last
+    Table table;
+    Journal journal;
+    JournalOptions journalOptions;
+    std::string snapshotPath;
+    std::string journalPath;
+    std::thread compactor;
+    password_storage storage;
+    uint32_t iterations;
+    std::unique_ptr<VerifyCache> cache;
+    bool log(JournalOp op, const std::string& user, const std::string& value = std::string());
+    void replay(const char* filename);
+    bool writeSnapshot() const;
+    std::vector<bool> matchBatch(const std::vector<std::pair<std::string, std::string>>& kvs) const;
     std::string encrypt(const std::string& str) const;
     std::string decrypt(const std::string& str) const;
+    std::string protect(const std::string& password) const;
+    bool verify(const std::string& password, const std::string& stored) const;
 };
 
 } 
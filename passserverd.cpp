@@ -0,0 +1,452 @@
+// passserverd serves a ConcurrentPassServer over TCP and Unix domain sockets.
+//
+// Each of --threads event loops owns an epoll instance. Every loop watches
+// the listening sockets with EPOLLEXCLUSIVE, so a new connection wakes one
+// loop, which keeps it for its lifetime; the loops share nothing but the
+// table, whose reads take no locks.
+//
+// Protocol: requests are lines of words separated by spaces, with the
+// letters of proj6's batch mode plus m for match:
+//   f USER   m USER PASS   a USER PASS   r USER   c USER OLD NEW   s
+// Every request gets one line back, in order: 1 or 0, the user count for s,
+// and ? for a malformed request. proj6's p, which prints a password, is not
+// served: no client is authenticated, so it would hand out every password.
+// Clients may pipeline: every complete line of a read is answered and the
+// answers go back in a single write. A connection stops being read while
+// more than max_pending bytes of answers wait for it, and one whose request
+// line grows past max_line bytes is closed once the earlier answers are out.
+//
+// Build: make passserverd
+// Usage: passserverd [--port N] [--bind ADDR] [--unix PATH] [--threads N] [--size N] [--shards N] [--load FILE]
+//        With neither --port nor --unix it listens on 127.0.0.1:4530.
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "concurrentpassserver.h"
+#include "mappedfile.h"
+
+using namespace cop4530;
+
+static const size_t read_chunk = 64 * 1024;
+static const size_t max_line = 64 * 1024;
+static const size_t max_pending = 4 * 1024 * 1024;
+static const int max_events = 256;
+static const int reads_per_wakeup = 16;
+static const int poll_millis = 200;
+
+static std::atomic<bool> stopping(false);
+
+static void onSignal(int) {
+    stopping.store(true);
+}
+
+// Answers one request line, appending the answer line to out.
+static void answer(ConcurrentPassServer& ps, std::string_view line, std::string& out) {
+    std::string_view w[4];
+    size_t count = split_words(line, w, 4);
+    char command = count > 0 && w[0].size() == 1 ? w[0][0] : '?';
+    bool ok;
+    switch (command) {
+        case 'f':
+            if (count != 2) break;
+            out += ps.find(std::string(w[1])) ? "1\n" : "0\n";
+            return;
+        case 'm':
+            if (count != 3) break;
+            out += ps.match(std::make_pair(std::string(w[1]), std::string(w[2]))) ? "1\n" : "0\n";
+            return;
+        case 'a':
+            if (count != 3) break;
+            out += ps.addUser(std::make_pair(std::string(w[1]), std::string(w[2]))) ? "1\n" : "0\n";
+            return;
+        case 'r':
+            if (count != 2) break;
+            out += ps.removeUser(std::string(w[1])) ? "1\n" : "0\n";
+            return;
+        case 'c':
+            if (count != 4) break;
+            ok = ps.changePassword(std::make_pair(std::string(w[1]), std::string(w[2])), std::string(w[3]));
+            out += ok ? "1\n" : "0\n";
+            return;
+        case 's':
+            if (count != 1) break;
+            out += std::to_string(ps.size());
+            out += '\n';
+            return;
+    }
+    out += "?\n";
+}
+
+// One client connection: the bytes of a request line still arriving and the
+// answers not yet written.
+struct Connection {
+    int fd;
+    std::string in;
+    std::string out;
+    size_t sent = 0;
+    uint32_t events = 0;
+    bool closing = false; // write what is left, then close
+};
+
+// One thread's event loop.
+class EventLoop {
+public:
+    EventLoop(ConcurrentPassServer& ps, const std::vector<int>& listeners) : ps(ps), listeners(listeners) {}
+    bool open();
+    void run();
+    size_t requestCount() const { return requests; }
+    size_t connectionCount() const { return accepted; }
+
+private:
+    ConcurrentPassServer& ps;
+    const std::vector<int>& listeners;
+    int epfd = -1;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    size_t requests = 0;
+    size_t accepted = 0;
+
+    void acceptAll(int listener);
+    void readable(Connection& c);
+    void writable(Connection& c);
+    void serve(Connection& c);
+    void watch(Connection& c);
+    void drop(Connection& c);
+};
+
+bool EventLoop::open() {
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        std::cerr << "** epoll_create1: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    for (int listener : listeners) {
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+        ev.data.fd = listener;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, listener, &ev) < 0) {
+            std::cerr << "** epoll_ctl: " << std::strerror(errno) << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+void EventLoop::run() {
+    epoll_event events[max_events];
+    while (!stopping.load(std::memory_order_relaxed)) {
+        int n = epoll_wait(epfd, events, max_events, poll_millis);
+        if (n < 0 && errno != EINTR) {
+            std::cerr << "** epoll_wait: " << std::strerror(errno) << "\n";
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (std::find(listeners.begin(), listeners.end(), fd) != listeners.end()) {
+                acceptAll(fd);
+                continue;
+            }
+            auto found = connections.find(fd);
+            if (found == connections.end()) {
+                continue;
+            }
+            Connection& c = *found->second;
+            if (events[i].events & (EPOLLERR | EPOLLHUP) && !(events[i].events & EPOLLIN)) {
+                drop(c);
+                continue;
+            }
+            if (events[i].events & EPOLLIN) {
+                readable(c);
+            } else if (events[i].events & EPOLLOUT) {
+                writable(c);
+            }
+        }
+    }
+    while (!connections.empty()) {
+        drop(*connections.begin()->second);
+    }
+    close(epfd);
+}
+
+void EventLoop::acceptAll(int listener) {
+    for (;;) {
+        int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cerr << "** accept: " << std::strerror(errno) << "\n";
+            }
+            return;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // fails harmlessly on Unix sockets
+        std::unique_ptr<Connection> c(new Connection());
+        c->fd = fd;
+        Connection& ref = *c;
+        connections.emplace(fd, std::move(c));
+        ++accepted;
+        watch(ref);
+    }
+}
+
+// Reads what is available, up to reads_per_wakeup chunks so one client
+// cannot hold the loop, answers every complete line and writes the answers
+// back at once.
+void EventLoop::readable(Connection& c) {
+    char buffer[read_chunk];
+    for (int reads = 0; reads < reads_per_wakeup; ++reads) {
+        ssize_t got = read(c.fd, buffer, sizeof(buffer));
+        if (got > 0) {
+            c.in.append(buffer, got);
+            if (static_cast<size_t>(got) < sizeof(buffer)) {
+                break;
+            }
+            continue;
+        }
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        // end of stream or an error: answer what arrived, then close
+        c.closing = true;
+        break;
+    }
+    serve(c);
+    writable(c);
+}
+
+void EventLoop::serve(Connection& c) {
+    size_t begin = 0;
+    for (;;) {
+        size_t newline = c.in.find('\n', begin);
+        if (newline == std::string::npos) {
+            break;
+        }
+        answer(ps, std::string_view(c.in).substr(begin, newline - begin), c.out);
+        ++requests;
+        begin = newline + 1;
+    }
+    c.in.erase(0, begin);
+    if (c.in.size() > max_line) {
+        c.in.clear();
+        c.closing = true;
+    }
+}
+
+void EventLoop::writable(Connection& c) {
+    while (c.sent < c.out.size()) {
+        ssize_t put = send(c.fd, c.out.data() + c.sent, c.out.size() - c.sent, MSG_NOSIGNAL);
+        if (put > 0) {
+            c.sent += put;
+        } else if (put < 0 && errno == EINTR) {
+            continue;
+        } else if (put < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            drop(c);
+            return;
+        }
+    }
+    if (c.sent == c.out.size()) {
+        c.out.clear();
+        c.sent = 0;
+        if (c.closing) {
+            drop(c);
+            return;
+        }
+    }
+    watch(c);
+}
+
+// Asks for input while the answers waiting are below max_pending and for
+// output while any wait at all.
+void EventLoop::watch(Connection& c) {
+    uint32_t wanted = 0;
+    if (!c.closing && c.out.size() - c.sent < max_pending) {
+        wanted |= EPOLLIN;
+    }
+    if (c.sent < c.out.size()) {
+        wanted |= EPOLLOUT;
+    }
+    if (wanted == c.events) {
+        return;
+    }
+    epoll_event ev{};
+    ev.events = wanted;
+    ev.data.fd = c.fd;
+    epoll_ctl(epfd, c.events == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, c.fd, &ev);
+    c.events = wanted;
+}
+
+void EventLoop::drop(Connection& c) {
+    int fd = c.fd;
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections.erase(fd);
+}
+
+static int listenTcp(const char* address, int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        std::cerr << "** socket: " << std::strerror(errno) << "\n";
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, address, &addr.sin_addr) != 1) {
+        std::cerr << "** Bad address " << address << "\n";
+        close(fd);
+        return -1;
+    }
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        std::cerr << "** Unable to listen on " << address << ":" << port << ": " << std::strerror(errno) << "\n";
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int listenUnix(const std::string& path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "** Socket path too long: " << path << "\n";
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        std::cerr << "** socket: " << std::strerror(errno) << "\n";
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        std::cerr << "** Unable to listen on " << path << ": " << std::strerror(errno) << "\n";
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char* argv[]) {
+    int port = -1;
+    std::string address = "127.0.0.1";
+    std::string unixPath;
+    size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    size_t size = 101;
+    size_t shards = 16;
+    std::string loadFile;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "** Missing value for " << arg << "\n";
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (arg == "--port") {
+            port = std::atoi(value.c_str());
+        } else if (arg == "--bind") {
+            address = value;
+        } else if (arg == "--unix") {
+            unixPath = value;
+        } else if (arg == "--threads") {
+            threads = std::max<size_t>(1, std::strtoul(value.c_str(), nullptr, 10));
+        } else if (arg == "--size") {
+            size = std::strtoul(value.c_str(), nullptr, 10);
+        } else if (arg == "--shards") {
+            shards = std::max<size_t>(1, std::strtoul(value.c_str(), nullptr, 10));
+        } else if (arg == "--load") {
+            loadFile = value;
+        } else {
+            std::cerr << "** Unknown option " << arg << "\n";
+            return 2;
+        }
+    }
+    if (port < 0 && unixPath.empty()) {
+        port = 4530;
+    }
+
+    ConcurrentPassServer ps(size, shards);
+    if (!loadFile.empty() && !ps.load(loadFile.c_str())) {
+        std::cerr << "** Unable to load " << loadFile << "\n";
+        return 1;
+    }
+
+    std::vector<int> listeners;
+    if (port >= 0) {
+        int fd = listenTcp(address.c_str(), port);
+        if (fd < 0) {
+            return 1;
+        }
+        listeners.push_back(fd);
+        std::cerr << "listening on " << address << ":" << port << "\n";
+    }
+    if (!unixPath.empty()) {
+        int fd = listenUnix(unixPath);
+        if (fd < 0) {
+            return 1;
+        }
+        listeners.push_back(fd);
+        std::cerr << "listening on " << unixPath << "\n";
+    }
+
+    struct sigaction action{};
+    action.sa_handler = onSignal;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    std::vector<std::unique_ptr<EventLoop>> loops;
+    for (size_t i = 0; i < threads; ++i) {
+        loops.emplace_back(new EventLoop(ps, listeners));
+        if (!loops.back()->open()) {
+            return 1;
+        }
+    }
+    std::cerr << ps.size() << " users, " << threads << " threads\n";
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(&EventLoop::run, loops[i].get());
+    }
+    loops[0]->run();
+    for (auto& t : workers) {
+        t.join();
+    }
+
+    size_t requests = 0;
+    size_t connections = 0;
+    for (const auto& loop : loops) {
+        requests += loop->requestCount();
+        connections += loop->connectionCount();
+    }
+    for (int fd : listeners) {
+        close(fd);
+    }
+    if (!unixPath.empty()) {
+        unlink(unixPath.c_str());
+    }
+    std::cerr << "served " << requests << " requests on " << connections << " connections\n";
+    return 0;
+}
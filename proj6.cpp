@@ -1,7 +1,12 @@
 #include <iostream>
 #include <list>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
 #include "hashtable.h"
 #include "passserver.h"
+#include "mappedfile.h"
 
 using namespace std;
 using namespace cop4530;
@@ -16,8 +21,14 @@ void useDisplayPassword(PassServer& ps);
 void useDumpHashTable(PassServer& ps);
 void useHashTableSize(PassServer& ps);
 void useWriteToFile(PassServer& ps);
+void useTableStats(PassServer& ps);
+int runBatch(int argc, char* argv[]);
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--batch") == 0) {
+        return runBatch(argc, argv);
+    }
 
-int main() {
     size_t size;
     cout << "Enter hash table size: ";
     cin >> size;
@@ -56,6 +67,9 @@ int main() {
         case 'w':
             useWriteToFile(ps);
                 break;
+        case 't':
+            useTableStats(ps);
+                break;
         case 'x':
             cout << "Exiting program." << endl;
                 break;
@@ -191,3 +205,232 @@ void useWriteToFile(PassServer& ps) {
         cout << "Error writing to file" << endl;
     }
 }
+
+// 't' is left out of PrintMenu, which must stay as provided
+void useTableStats(PassServer& ps) {
+    TableStats stats = ps.stats();
+    cout << "Entries: " << stats.size << endl;
+    cout << "Buckets: " << stats.buckets << endl;
+    cout << "Load factor: " << stats.load_factor << endl;
+    cout << "Chain lengths:";
+    for (size_t length = 0; length < stats.chain_lengths.size(); ++length) {
+        if (stats.chain_lengths[length] > 0) {
+            cout << " " << length << ":" << stats.chain_lengths[length];
+        }
+    }
+    cout << endl;
+    cout << "Longest chain: " << stats.max_probe << endl;
+    cout << "Rehashes: " << stats.rehashes << " taking " << stats.rehash_seconds * 1000 << " ms" << endl;
+    cout << "Lookups: " << stats.lookups.hits << " hits, " << stats.lookups.misses << " misses" << endl;
+    cout << "Matches: " << stats.matches.hits << " hits, " << stats.matches.misses << " misses" << endl;
+    cout << "Inserts: " << stats.inserts.hits << " added, " << stats.inserts.misses << " rejected" << endl;
+    cout << "Removes: " << stats.removes.hits << " removed, " << stats.removes.misses << " not found" << endl;
+    cout << "Estimated bytes: " << stats.bytes << endl;
+    if (stats.filter_bytes > 0) {
+        cout << "Filter: " << stats.filter_bytes << " bytes, " << stats.filter_rejections << " rejected, "
+             << stats.filter_false_positives << " false positives (" << stats.filter_false_positive_rate << ")" << endl;
+    }
+}
+
+// Batch mode: proj6 --batch [--size N] [--hashed ITERATIONS] [--filter] [FILE]
+//
+// Reads commands from FILE, or stdin when it is omitted or "-", one per line
+// with the menu's letters and their answers on the same line:
+//   l FILE   a USER PASS   r USER   c USER OLD NEW   f USER   p USER
+//   d        s             w FILE   t                x
+// Blank lines and lines starting with '#' are skipped. No menus or prompts
+// are printed; each command writes one line: 1 or 0 for l, a, r, c, f and w,
+// the decoded password or NOT FOUND for p, the entry count for s, one line
+// of stats for t, and the table's lines for d. A malformed command writes ?
+// and a message to cerr, so results stay one per command for diffing. Input
+// is read and output written in 1 MB blocks. A summary of the command count
+// and rate goes to cerr at the end. --hashed stores passwords as salted
+// PBKDF2 hashes of that many iterations, so p answers NOT AVAILABLE for them.
+// --filter turns on the table's negative filter, and t then ends with its
+// false-positive rate.
+namespace {
+
+const size_t batch_buffer = 1 << 20;
+
+// Reads lines through a large buffer, without a copy for lines that fit in it.
+class LineReader {
+public:
+    explicit LineReader(FILE* in) : in(in), buffer(batch_buffer), begin(0), end(0), eof(false) {}
+
+    bool next(string_view& line) {
+        for (;;) {
+            const char* start = buffer.data() + begin;
+            const char* newline = static_cast<const char*>(memchr(start, '\n', end - begin));
+            if (newline) {
+                line = string_view(start, newline - start);
+                begin += line.size() + 1;
+                return true;
+            }
+            if (eof) {
+                if (begin == end) {
+                    return false;
+                }
+                line = string_view(start, end - begin); // last line has no newline
+                begin = end;
+                return true;
+            }
+            // keep the partial line, growing the buffer for a line longer than it
+            memmove(buffer.data(), start, end - begin);
+            end -= begin;
+            begin = 0;
+            if (end == buffer.size()) {
+                buffer.resize(buffer.size() * 2);
+            }
+            size_t got = fread(buffer.data() + end, 1, buffer.size() - end, in);
+            end += got;
+            eof = got == 0;
+        }
+    }
+
+private:
+    FILE* in;
+    vector<char> buffer;
+    size_t begin;
+    size_t end;
+    bool eof;
+};
+
+void flushOutput(string& out) {
+    cout.write(out.data(), out.size());
+    out.clear();
+}
+
+// the argument count each command takes after its letter
+int argumentsOf(char command) {
+    switch (command) {
+        case 'l': case 'r': case 'f': case 'p': case 'w':
+            return 1;
+        case 'a':
+            return 2;
+        case 'c':
+            return 3;
+        case 'd': case 's': case 't': case 'x':
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+}
+
+int runBatch(int argc, char* argv[]) {
+    size_t size = 101;
+    uint32_t iterations = 0;
+    bool filter = false;
+    const char* filename = nullptr;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--hashed") == 0 && i + 1 < argc) {
+            iterations = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--filter") == 0) {
+            filter = true;
+        } else if (!filename) {
+            filename = argv[i];
+        } else {
+            cerr << "usage: proj6 --batch [--size N] [--hashed ITERATIONS] [--filter] [FILE]" << endl;
+            return 2;
+        }
+    }
+    FILE* in = stdin;
+    if (filename && strcmp(filename, "-") != 0) {
+        in = fopen(filename, "rb");
+        if (!in) {
+            cerr << "** Unable to open " << filename << endl;
+            return 1;
+        }
+    }
+
+    ios::sync_with_stdio(false);
+    PassServer ps(size);
+    if (iterations > 0) {
+        ps.set_password_storage(password_storage::hashed, iterations);
+    }
+    ps.set_negative_filter(filter);
+    LineReader reader(in);
+    string out;
+    out.reserve(batch_buffer + 4096);
+    string_view line;
+    string_view words[4];
+    size_t lineNumber = 0;
+    size_t commands = 0;
+    auto start = chrono::steady_clock::now();
+    while (reader.next(line)) {
+        ++lineNumber;
+        size_t count = split_words(line, words, 4);
+        if (count == 0 || words[0][0] == '#') {
+            continue;
+        }
+        ++commands;
+        char command = words[0].size() == 1 ? words[0][0] : '?';
+        if (argumentsOf(command) != static_cast<int>(count) - 1) {
+            cerr << "** line " << lineNumber << ": bad command: " << line << "\n";
+            out += "?\n";
+            continue;
+        }
+        if (command == 'x') {
+            break;
+        }
+        switch (command) {
+            case 'l':
+                out += ps.load(string(words[1]).c_str()) ? "1\n" : "0\n";
+                break;
+            case 'a':
+                out += ps.addUser(make_pair(string(words[1]), string(words[2]))) ? "1\n" : "0\n";
+                break;
+            case 'r':
+                out += ps.removeUser(words[1]) ? "1\n" : "0\n";
+                break;
+            case 'c':
+                out += ps.changePassword(make_pair(string(words[1]), string(words[2])), string(words[3])) ? "1\n" : "0\n";
+                break;
+            case 'f':
+                out += ps.find(words[1]) ? "1\n" : "0\n";
+                break;
+            case 'p':
+                out += ps.decodepw(words[1]);
+                out += '\n';
+                break;
+            case 'd':
+                flushOutput(out);
+                ps.dump();
+                break;
+            case 's':
+                out += to_string(ps.size());
+                out += '\n';
+                break;
+            case 'w':
+                out += ps.write_to_file(string(words[1]).c_str()) ? "1\n" : "0\n";
+                break;
+            case 't': {
+                TableStats stats = ps.stats();
+                out += "size=" + to_string(stats.size) + " buckets=" + to_string(stats.buckets) +
+                       " longest=" + to_string(stats.max_probe) + " rehashes=" + to_string(stats.rehashes) +
+                       " bytes=" + to_string(stats.bytes);
+                if (stats.filter_bytes > 0) {
+                    out += " filter_rejections=" + to_string(stats.filter_rejections) +
+                           " filter_fpr=" + to_string(stats.filter_false_positive_rate);
+                }
+                out += '\n';
+                break;
+            }
+        }
+        if (out.size() >= batch_buffer) {
+            flushOutput(out);
+        }
+    }
+    flushOutput(out);
+    cout.flush();
+    if (in != stdin) {
+        fclose(in);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cerr << commands << " commands in " << seconds << " s (" << static_cast<size_t>(commands / max(seconds, 1e-9))
+         << " per second)" << endl;
+    return cout ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+#ifndef RCUHASHTABLE_H
+#define RCUHASHTABLE_H
+
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include "hashtable.h"
+#include "epoch.h"
+
+namespace cop4530 {
+
+// Separate chaining table whose lookups take no lock. Chains are linked
+// through atomic pointers and entries are never changed in place: a writer
+// links in a new node and retires the old one through epoch_retire(), and a
+// rehash publishes a complete new bucket array. Readers only hold an
+// EpochGuard. Any number of readers may run alongside one writer; the
+// caller serializes writers.
+template <typename K, typename V>
+class RcuHashTable {
+public:
+    explicit RcuHashTable(size_t size = 101);
+    ~RcuHashTable();
+    bool contains(const K& k) const;
+    bool match(const std::pair<K, V>& kv) const;
+    bool insert(const std::pair<K, V>& kv);
+    bool update(const std::pair<K, V>& kv);
+    bool remove(const K& k);
+    void clear();
+    void replace(std::vector<std::pair<K, V>>&& pairs);
+    std::string getpassword(const std::string& user) const;
+    void dump() const;
+    bool write(std::ostream& out) const;
+    template <typename Emit>
+    bool writeText(Emit emit) const;
+    size_t size() const;
+
+private:
+    struct Node {
+        Node(const K& k, const V& v, Node* n) : kv(k, v), next(n) {}
+        const std::pair<K, V> kv;
+        std::atomic<Node*> next;
+    };
+    struct Buckets {
+        explicit Buckets(size_t n) : count(n), heads(new std::atomic<Node*>[n]) {
+            for (size_t i = 0; i < n; ++i) {
+                heads[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+        ~Buckets();
+        size_t count;
+        std::atomic<Node*>* heads;
+    };
+    std::atomic<Buckets*> buckets;
+    std::atomic<size_t> currentSize;
+    const Node* find(const Buckets* b, const K& k) const;
+    std::atomic<Node*>* link(Buckets* b, const K& k) const;
+    void rehash();
+    size_t myhash(const K& k) const;
+    std::string encrypt(const std::string& str) const;
+    std::string decrypt(const std::string& str) const;
+};
+
+}
+#include "rcuhashtable.hpp"
+
+#endif
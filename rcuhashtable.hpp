@@ -0,0 +1,477 @@
+#ifndef RCUHASHTABLE_HPP
+#define RCUHASHTABLE_HPP
+
+#include "rcuhashtable.h"
+
+namespace cop4530 {
+
+    // ***********************************************************************
+    // * Function Name: ~Buckets                                             *
+    // * Description: Frees a bucket array together with every node chained *
+    // *              from it. Only runs once no reader can reach the array  *
+    // *                                                                     *
+    // * Parameter Description: none                                         *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+RcuHashTable<K, V>::Buckets::~Buckets() {
+    for (size_t i = 0; i < count; ++i) {
+        Node* n = heads[i].load(std::memory_order_relaxed);
+        while (n) {
+            Node* next = n->next.load(std::memory_order_relaxed);
+            delete n;
+            n = next;
+        }
+    }
+    delete[] heads;
+}
+
+    // ***********************************************************************
+    // * Function Name: RcuHashTable                                         *
+    // * Description: Constructor, sizes the bucket array to the first entry *
+    // *              of prime_sizes at or above size                        *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t size: initial size of the hash table                       *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+RcuHashTable<K, V>::RcuHashTable(size_t size) : currentSize(0) {
+    if (size < 1) {
+        size = 101;
+    }
+    auto last = std::end(prime_sizes) - 1;
+    auto primeSize = std::lower_bound(std::begin(prime_sizes), last, size);
+    buckets.store(new Buckets(static_cast<size_t>(*primeSize)), std::memory_order_release);
+}
+
+    // ***********************************************************************
+    // * Function Name: ~RcuHashTable                                        *
+    // * Description: Destructor, frees the live bucket array. Readers must  *
+    // *              have finished with the table                           *
+    // *                                                                     *
+    // * Parameter Description: none                                         *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+RcuHashTable<K, V>::~RcuHashTable() {
+    delete buckets.load(std::memory_order_acquire);
+}
+
+    // ***********************************************************************
+    // * Function Name: contains                                             *
+    // * Description: Checks if a key is in the hash table without locking   *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const K& k: The key to check for in the hash table                *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+bool RcuHashTable<K, V>::contains(const K& k) const {
+    EpochGuard guard;
+    return find(buckets.load(std::memory_order_acquire), k) != nullptr;
+}
+
+    // ***********************************************************************
+    // * Function Name: match                                                *
+    // * Description: Checks if a given key value pair is in the table. The  *
+    // *              value is encrypted before the guard is taken           *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::pair<K, V>& kv: The key value pair to check for        *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+bool RcuHashTable<K, V>::match(const std::pair<K, V>& kv) const {
+    auto encryptedValue = encrypt(kv.second);
+    EpochGuard guard;
+    const Node* n = find(buckets.load(std::memory_order_acquire), kv.first);
+    return n && n->kv.second == encryptedValue;
+}
+
+    // ***********************************************************************
+    // * Function Name: insert                                               *
+    // * Description: Publishes a new node at the head of its chain. Fails   *
+    // *              if the key exists. Writers only                        *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::pair<K, V>& kv: The key value pair to insert           *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+bool RcuHashTable<K, V>::insert(const std::pair<K, V>& kv) {
+    Buckets* b = buckets.load(std::memory_order_relaxed);
+    if (find(b, kv.first)) {
+        return false;
+    }
+    std::atomic<Node*>& head = b->heads[myhash(kv.first) % b->count];
+    head.store(new Node(kv.first, encrypt(kv.second), head.load(std::memory_order_relaxed)),
+               std::memory_order_release);
+    if (currentSize.fetch_add(1, std::memory_order_relaxed) + 1 > b->count) {
+        rehash();
+    }
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: update                                               *
+    // * Description: Replaces the value of an existing key. The new node    *
+    // *              takes the old one's place in a single store, so a      *
+    // *              reader sees either the old or the new value, never     *
+    // *              neither. Writers only                                  *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::pair<K, V>& kv: The key and its new value              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+bool RcuHashTable<K, V>::update(const std::pair<K, V>& kv) {
+    std::atomic<Node*>* l = link(buckets.load(std::memory_order_relaxed), kv.first);
+    if (!l) {
+        return false;
+    }
+    Node* old = l->load(std::memory_order_relaxed);
+    l->store(new Node(kv.first, encrypt(kv.second), old->next.load(std::memory_order_relaxed)),
+             std::memory_order_release);
+    epoch_retire(old);
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: remove                                               *
+    // * Description: Unlinks a key's node and retires it. Readers already   *
+    // *              on the node can still follow its next pointer          *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const K& k: The key to remove                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+bool RcuHashTable<K, V>::remove(const K& k) {
+    std::atomic<Node*>* l = link(buckets.load(std::memory_order_relaxed), k);
+    if (!l) {
+        return false;
+    }
+    Node* victim = l->load(std::memory_order_relaxed);
+    l->store(victim->next.load(std::memory_order_relaxed), std::memory_order_release);
+    epoch_retire(victim);
+    currentSize.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: clear                                                *
+    // * Description: Publishes an empty bucket array of the same size and   *
+    // *              retires the old one                                    *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+void RcuHashTable<K, V>::clear() {
+    Buckets* old = buckets.load(std::memory_order_relaxed);
+    buckets.store(new Buckets(old->count), std::memory_order_release);
+    currentSize.store(0, std::memory_order_relaxed);
+    epoch_retire(old);
+}
+
+    // ***********************************************************************
+    // * Function Name: replace                                              *
+    // * Description: Builds a bucket array holding the given pairs, sized   *
+    // *              for them, and publishes it in place of the live one in *
+    // *              a single store, so a reader sees either the old        *
+    // *              contents or the new ones, never one partly filled.     *
+    // *              The first pair of a repeated key wins, as with insert. *
+    // *              Writers only                                           *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::vector<std::pair<K, V>>&& pairs: The new contents            *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+void RcuHashTable<K, V>::replace(std::vector<std::pair<K, V>>&& pairs) {
+    auto last = std::end(prime_sizes) - 1;
+    auto primeSize = std::lower_bound(std::begin(prime_sizes), last, std::max<size_t>(pairs.size(), 101));
+    Buckets* fresh = new Buckets(static_cast<size_t>(*primeSize));
+    size_t added = 0;
+    for (auto& kv : pairs) {
+        if (find(fresh, kv.first)) {
+            continue;
+        }
+        std::atomic<Node*>& head = fresh->heads[myhash(kv.first) % fresh->count];
+        head.store(new Node(kv.first, encrypt(kv.second), head.load(std::memory_order_relaxed)),
+                   std::memory_order_relaxed);
+        ++added;
+    }
+    pairs.clear();
+    Buckets* old = buckets.load(std::memory_order_relaxed);
+    buckets.store(fresh, std::memory_order_release);
+    currentSize.store(added, std::memory_order_relaxed);
+    epoch_retire(old);
+}
+
+    // ***********************************************************************
+    // * Function Name: getpassword                                          *
+    // * Description: Retrieves the password for a user                      *
+    // * Parameter Description:                                              *
+    // * - const std::string& user: The username to look up.                 *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+std::string RcuHashTable<K, V>::getpassword(const std::string& user) const {
+    V stored;
+    {
+        EpochGuard guard;
+        const Node* n = find(buckets.load(std::memory_order_acquire), user);
+        if (!n) {
+            return "NOT FOUND";
+        }
+        stored = n->kv.second;
+    }
+    return decrypt(stored);
+}
+
+    // ***********************************************************************
+    // * Function Name: dump                                                 *
+    // * Description: Outputs all key value pairs in the hash table          *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+void RcuHashTable<K, V>::dump() const {
+    write(std::cout);
+}
+
+    // ***********************************************************************
+    // * Function Name: write                                                *
+    // * Description: Writes all key value pairs to an open stream, one pair *
+    // *              per line                                               *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::ostream& out: The stream to write to                         *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+bool RcuHashTable<K, V>::write(std::ostream& out) const {
+    writeText([&out](const std::string& chunk) {
+        out.write(chunk.data(), chunk.size());
+        return static_cast<bool>(out);
+    });
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+    // ***********************************************************************
+    // * Function Name: writeText                                            *
+    // * Description: Formats every pair as a "key value" line and passes    *
+    // *              the text to emit a chunk at a time, formatting bucket  *
+    // *              ranges on several threads. The bucket array is read    *
+    // *              once, under the caller's guard, which keeps it and     *
+    // *              its nodes alive until every range is done              *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - Emit emit: Called with each chunk, returns false to stop          *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+template <typename Emit>
+bool RcuHashTable<K, V>::writeText(Emit emit) const {
+    EpochGuard guard;
+    const Buckets* b = buckets.load(std::memory_order_acquire);
+    auto format = [b](size_t begin, size_t end, std::string& chunk) {
+        for (size_t i = begin; i < end; ++i) {
+            for (const Node* n = b->heads[i].load(std::memory_order_acquire); n;
+                 n = n->next.load(std::memory_order_acquire)) {
+                detail::append_text(chunk, n->kv.first);
+                chunk += ' ';
+                detail::append_text(chunk, n->kv.second);
+                chunk += '\n';
+            }
+        }
+    };
+    return detail::format_chunks(b->count, format, emit);
+}
+
+    // ***********************************************************************
+    // * Function Name: size                                                 *
+    // * Description: Returns the number of key value pairs in the hash table*
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+size_t RcuHashTable<K, V>::size() const {
+    return currentSize.load(std::memory_order_relaxed);
+}
+
+    // ***********************************************************************
+    // * Function Name: find                                                 *
+    // * Description: Walks k's chain in bucket array b. The caller holds an *
+    // *              EpochGuard or is the writer                            *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const Buckets* b: The bucket array to search                      *
+    // * - const K& k: The key to find                                       *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+const typename RcuHashTable<K, V>::Node* RcuHashTable<K, V>::find(const Buckets* b, const K& k) const {
+    const Node* n = b->heads[myhash(k) % b->count].load(std::memory_order_acquire);
+    while (n && !(n->kv.first == k)) {
+        n = n->next.load(std::memory_order_acquire);
+    }
+    return n;
+}
+
+    // ***********************************************************************
+    // * Function Name: link                                                 *
+    // * Description: Returns the pointer that points at k's node, either a  *
+    // *              bucket head or the previous node's next, or nullptr    *
+    // *              when k is absent. Writers only                         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - Buckets* b: The bucket array to search                            *
+    // * - const K& k: The key to find                                       *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+std::atomic<typename RcuHashTable<K, V>::Node*>* RcuHashTable<K, V>::link(Buckets* b, const K& k) const {
+    std::atomic<Node*>* l = &b->heads[myhash(k) % b->count];
+    for (Node* n = l->load(std::memory_order_relaxed); n; n = l->load(std::memory_order_relaxed)) {
+        if (n->kv.first == k) {
+            return l;
+        }
+        l = &n->next;
+    }
+    return nullptr;
+}
+
+    // ***********************************************************************
+    // * Function Name: rehash                                               *
+    // * Description: Copies every entry into a bucket array about twice as  *
+    // *              large and publishes it. Nodes are copied, not moved,   *
+    // *              because readers may still be walking the old chains;   *
+    // *              the old array and its nodes are retired together       *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+void RcuHashTable<K, V>::rehash() {
+    Buckets* old = buckets.load(std::memory_order_relaxed);
+    auto last = std::end(prime_sizes) - 1;
+    auto next = std::upper_bound(std::begin(prime_sizes), last, old->count + old->count / 2);
+    Buckets* fresh = new Buckets(static_cast<size_t>(*next));
+    for (size_t i = 0; i < old->count; ++i) {
+        for (Node* n = old->heads[i].load(std::memory_order_relaxed); n;
+             n = n->next.load(std::memory_order_relaxed)) {
+            std::atomic<Node*>& head = fresh->heads[myhash(n->kv.first) % fresh->count];
+            head.store(new Node(n->kv.first, n->kv.second, head.load(std::memory_order_relaxed)),
+                       std::memory_order_relaxed);
+        }
+    }
+    buckets.store(fresh, std::memory_order_release);
+    epoch_retire(old);
+}
+
+    // ***********************************************************************
+    // * Function Name: myhash                                               *
+    // * Description: Calculates the hash value for a key                    *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const K& k: The key to hash.                                      *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+size_t RcuHashTable<K, V>::myhash(const K& k) const {
+    static std::hash<K> hf;
+    return hf(k);
+}
+
+    // ***********************************************************************
+    // * Function Name: encrypt                                              *
+    // * Description: Encrypts a string using base64                         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::string& str:  string to be encrypted                   *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+std::string RcuHashTable<K, V>::encrypt(const std::string& str) const {
+    std::string encoded;
+    encoded.resize(((str.size() + 2) / 3) * 4);
+
+    base64_encode(reinterpret_cast<const BYTE*>(str.data()), reinterpret_cast<BYTE*>(&encoded[0]), str.size(), 0);
+    return encoded;
+}
+
+    // ***********************************************************************
+    // * Function Name: decrypt                                              *
+    // * Description: Decrypts a base64 encoded string                       *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const std::string& str: The string to be decrypted                *
+    // *                                                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+template <typename K, typename V>
+std::string RcuHashTable<K, V>::decrypt(const std::string& str) const {
+    std::string decoded;
+    decoded.resize((str.size() * 3) / 4);
+
+    base64_decode(reinterpret_cast<const BYTE*>(str.data()), reinterpret_cast<BYTE*>(&decoded[0]), str.size());
+    return decoded;
+}
+
+}
+#endif
@@ -0,0 +1,455 @@
+#include "sha256.h"
+#include <algorithm>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SHA256_X86_LANES 1
+#endif
+
+namespace cop4530 {
+
+namespace {
+
+const uint32_t round_constants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+const uint32_t initial_state[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+inline uint32_t load_be(const unsigned char* p) {
+    return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 |
+           static_cast<uint32_t>(p[2]) << 8 | p[3];
+}
+
+inline void store_be(unsigned char* p, uint32_t v) {
+    p[0] = static_cast<unsigned char>(v >> 24);
+    p[1] = static_cast<unsigned char>(v >> 16);
+    p[2] = static_cast<unsigned char>(v >> 8);
+    p[3] = static_cast<unsigned char>(v);
+}
+
+// The compression function is written once over V, which is uint32_t for a
+// single message or a GCC vector of 32 bit lanes for one message per lane;
+// every operator below means the same on both. The rotation is a macro
+// because a function returning a wide vector would change the ABI of code
+// built without AVX.
+#define SHA256_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+template <typename V>
+inline __attribute__((always_inline)) void compress(V state[8], const V block[16]) {
+    V w[64];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = block[i];
+    }
+    for (int i = 16; i < 64; ++i) {
+        V s0 = SHA256_ROTR(w[i - 15], 7) ^ SHA256_ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        V s1 = SHA256_ROTR(w[i - 2], 17) ^ SHA256_ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    V a = state[0], b = state[1], c = state[2], d = state[3];
+    V e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i) {
+        V t1 = h + (SHA256_ROTR(e, 6) ^ SHA256_ROTR(e, 11) ^ SHA256_ROTR(e, 25)) + ((e & f) ^ (~e & g)) +
+               round_constants[i] + w[i];
+        V t2 = (SHA256_ROTR(a, 2) ^ SHA256_ROTR(a, 13) ^ SHA256_ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+void compress_bytes(uint32_t state[8], const unsigned char* p) {
+    uint32_t block[16];
+    for (int i = 0; i < 16; ++i) {
+        block[i] = load_be(p + 4 * i);
+    }
+    compress(state, block);
+}
+
+// A message being hashed, which may start from the state left by blocks
+// already compressed, as HMAC's do after the key block.
+struct Context {
+    uint32_t state[8];
+    unsigned char buffer[64];
+    size_t used;
+    uint64_t length;
+
+    Context(const uint32_t start[8] = initial_state, uint64_t done = 0) : used(0), length(done) {
+        std::memcpy(state, start, sizeof(state));
+    }
+
+    void update(const void* data, size_t n) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        length += n;
+        if (used > 0) {
+            size_t take = std::min(n, sizeof(buffer) - used);
+            std::memcpy(buffer + used, p, take);
+            used += take;
+            p += take;
+            n -= take;
+            if (used < sizeof(buffer)) {
+                return;
+            }
+            compress_bytes(state, buffer);
+            used = 0;
+        }
+        for (; n >= 64; p += 64, n -= 64) {
+            compress_bytes(state, p);
+        }
+        std::memcpy(buffer, p, n);
+        used = n;
+    }
+
+    void finish(unsigned char out[sha256_bytes]) {
+        uint64_t bits = length * 8;
+        buffer[used++] = 0x80;
+        if (used > 56) {
+            std::memset(buffer + used, 0, sizeof(buffer) - used);
+            compress_bytes(state, buffer);
+            used = 0;
+        }
+        std::memset(buffer + used, 0, 56 - used);
+        store_be(buffer + 56, static_cast<uint32_t>(bits >> 32));
+        store_be(buffer + 60, static_cast<uint32_t>(bits));
+        compress_bytes(state, buffer);
+        for (int i = 0; i < 8; ++i) {
+            store_be(out + 4 * i, state[i]);
+        }
+    }
+};
+
+// The states of HMAC's inner and outer hashes after their key block, which
+// every message under the key starts from.
+struct HmacKey {
+    uint32_t inner[8];
+    uint32_t outer[8];
+
+    HmacKey(const void* key, size_t n) {
+        unsigned char block[64] = {};
+        if (n > sizeof(block)) {
+            sha256(key, n, block);
+        } else if (n > 0) {
+            std::memcpy(block, key, n);
+        }
+        unsigned char pad[64];
+        for (int i = 0; i < 64; ++i) {
+            pad[i] = block[i] ^ 0x36;
+        }
+        std::memcpy(inner, initial_state, sizeof(inner));
+        compress_bytes(inner, pad);
+        for (int i = 0; i < 64; ++i) {
+            pad[i] = block[i] ^ 0x5c;
+        }
+        std::memcpy(outer, initial_state, sizeof(outer));
+        compress_bytes(outer, pad);
+    }
+
+    // U_1 of PBKDF2 block index, HMAC(key, salt || index), as words
+    void first_block(std::string_view salt, uint32_t index, uint32_t u[8]) const {
+        unsigned char digest[sha256_bytes];
+        unsigned char counter[4];
+        store_be(counter, index);
+        Context in(inner, 64);
+        in.update(salt.data(), salt.size());
+        in.update(counter, sizeof(counter));
+        in.finish(digest);
+        Context out(outer, 64);
+        out.update(digest, sizeof(digest));
+        out.finish(digest);
+        for (int i = 0; i < 8; ++i) {
+            u[i] = load_be(digest + 4 * i);
+        }
+    }
+};
+
+// The state of N derivations, word-major so that [j] loads as one vector:
+// inner[j][lane] is word j of that lane's inner key state. u holds U_1 on
+// entry and the derived key, U_1 ^ ... ^ U_c, on return.
+template <size_t N>
+struct Lanes {
+    uint32_t inner[8][N];
+    uint32_t outer[8][N];
+    uint32_t u[8][N];
+};
+
+// PBKDF2's remaining rounds for every lane. Each U after the first is the
+// HMAC of the 32 byte U before it, which after the 64 byte key block is one
+// padded block for the inner hash and one for the outer.
+template <typename V, size_t N>
+inline __attribute__((always_inline)) void iterate(Lanes<N>& lanes, uint32_t rounds) {
+    static_assert(sizeof(V) == N * sizeof(uint32_t), "one lane per word");
+    V inner[8], outer[8], u[8], t[8], state[8], block[16];
+    for (int j = 0; j < 8; ++j) {
+        std::memcpy(&inner[j], lanes.inner[j], sizeof(V));
+        std::memcpy(&outer[j], lanes.outer[j], sizeof(V));
+        std::memcpy(&u[j], lanes.u[j], sizeof(V));
+        t[j] = u[j];
+    }
+    V zero = {};
+    block[8] = zero + 0x80000000u;
+    for (int j = 9; j < 15; ++j) {
+        block[j] = zero;
+    }
+    block[15] = zero + (64 + sha256_bytes) * 8;
+    for (uint32_t r = 0; r < rounds; ++r) {
+        for (int j = 0; j < 8; ++j) {
+            block[j] = u[j];
+            state[j] = inner[j];
+        }
+        compress(state, block);
+        for (int j = 0; j < 8; ++j) {
+            block[j] = state[j];
+            state[j] = outer[j];
+        }
+        compress(state, block);
+        for (int j = 0; j < 8; ++j) {
+            u[j] = state[j];
+            t[j] ^= state[j];
+        }
+    }
+    for (int j = 0; j < 8; ++j) {
+        std::memcpy(lanes.u[j], &t[j], sizeof(V));
+    }
+}
+
+void iterate_x1(Lanes<1>& lanes, uint32_t rounds) {
+    iterate<uint32_t, 1>(lanes, rounds);
+}
+
+#ifdef __GNUC__
+typedef uint32_t u32x4 __attribute__((vector_size(16)));
+
+void iterate_x4(Lanes<4>& lanes, uint32_t rounds) {
+    iterate<u32x4, 4>(lanes, rounds);
+}
+#endif
+
+#ifdef SHA256_X86_LANES
+typedef uint32_t u32x8 __attribute__((vector_size(32)));
+typedef uint32_t u32x16 __attribute__((vector_size(64)));
+
+__attribute__((target("avx2")))
+void iterate_x8(Lanes<8>& lanes, uint32_t rounds) {
+    iterate<u32x8, 8>(lanes, rounds);
+}
+
+__attribute__((target("avx512f")))
+void iterate_x16(Lanes<16>& lanes, uint32_t rounds) {
+    iterate<u32x16, 16>(lanes, rounds);
+}
+#endif
+
+size_t select_lanes() {
+#ifdef SHA256_X86_LANES
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return 16;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return 8;
+    }
+#endif
+#ifdef __GNUC__
+    return 4;
+#else
+    return 1;
+#endif
+}
+
+// Derives up to N of jobs in one pass of kernel; unused lanes hash zeros
+template <size_t N>
+void run_lanes(const Pbkdf2Job* jobs, size_t count, uint32_t iterations, void (*kernel)(Lanes<N>&, uint32_t)) {
+    Lanes<N> lanes = {};
+    for (size_t i = 0; i < count; ++i) {
+        HmacKey key(jobs[i].password.data(), jobs[i].password.size());
+        uint32_t u[8];
+        key.first_block(jobs[i].salt, 1, u);
+        for (int j = 0; j < 8; ++j) {
+            lanes.inner[j][i] = key.inner[j];
+            lanes.outer[j][i] = key.outer[j];
+            lanes.u[j][i] = u[j];
+        }
+    }
+    kernel(lanes, iterations > 1 ? iterations - 1 : 0);
+    for (size_t i = 0; i < count; ++i) {
+        for (int j = 0; j < 8; ++j) {
+            store_be(jobs[i].out + 4 * j, lanes.u[j][i]);
+        }
+    }
+}
+
+}
+
+    // ***********************************************************************
+    // * Function Name: sha256                                               *
+    // * Description: Hashes n bytes with SHA-256                            *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const void* data: The bytes to hash                               *
+    // * - size_t n: The number of bytes                                     *
+    // * - unsigned char out[]: Receives the 32 byte digest                  *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void sha256(const void* data, size_t n, unsigned char out[sha256_bytes]) {
+    Context context;
+    context.update(data, n);
+    context.finish(out);
+}
+
+    // ***********************************************************************
+    // * Function Name: hmac_sha256                                          *
+    // * Description: Computes HMAC-SHA256 of n bytes under a key            *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const void* key: The key                                          *
+    // * - size_t keyLength: The number of key bytes                         *
+    // * - const void* data: The message                                     *
+    // * - size_t n: The number of message bytes                             *
+    // * - unsigned char out[]: Receives the 32 byte MAC                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void hmac_sha256(const void* key, size_t keyLength, const void* data, size_t n, unsigned char out[sha256_bytes]) {
+    HmacKey prepared(key, keyLength);
+    unsigned char digest[sha256_bytes];
+    Context inner(prepared.inner, 64);
+    inner.update(data, n);
+    inner.finish(digest);
+    Context outer(prepared.outer, 64);
+    outer.update(digest, sizeof(digest));
+    outer.finish(out);
+}
+
+    // ***********************************************************************
+    // * Function Name: pbkdf2_sha256                                        *
+    // * Description: Derives a key of any length with PBKDF2-HMAC-SHA256,   *
+    // *              one 32 byte block at a time on the scalar code. An     *
+    // *              iteration count of 0 is taken as 1                     *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::string_view password: The password                           *
+    // * - std::string_view salt: The salt                                   *
+    // * - uint32_t iterations: The iteration count                          *
+    // * - unsigned char* out: Receives the derived key                      *
+    // * - size_t outLength: The number of bytes to derive                   *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void pbkdf2_sha256(std::string_view password, std::string_view salt, uint32_t iterations,
+                   unsigned char* out, size_t outLength) {
+    HmacKey key(password.data(), password.size());
+    for (uint32_t index = 1; outLength > 0; ++index) {
+        Lanes<1> lanes;
+        uint32_t u[8];
+        key.first_block(salt, index, u);
+        for (int j = 0; j < 8; ++j) {
+            lanes.inner[j][0] = key.inner[j];
+            lanes.outer[j][0] = key.outer[j];
+            lanes.u[j][0] = u[j];
+        }
+        iterate_x1(lanes, iterations > 1 ? iterations - 1 : 0);
+        unsigned char block[sha256_bytes];
+        for (int j = 0; j < 8; ++j) {
+            store_be(block + 4 * j, lanes.u[j][0]);
+        }
+        size_t take = std::min(outLength, sizeof(block));
+        std::memcpy(out, block, take);
+        out += take;
+        outLength -= take;
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: pbkdf2_sha256_many                                   *
+    // * Description: Derives a 32 byte key for each job, as many at once as *
+    // *              the lanes allow. A batch that does not fill the widest *
+    // *              kernel finishes on the narrowest one it fits in        *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const Pbkdf2Job* jobs: The passwords, salts and outputs           *
+    // * - size_t count: The number of jobs                                  *
+    // * - uint32_t iterations: The iteration count shared by every job      *
+    // * - size_t lanes: The most lanes to use, 0 for the widest available   *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void pbkdf2_sha256_many(const Pbkdf2Job* jobs, size_t count, uint32_t iterations, size_t lanes) {
+    size_t widest = pbkdf2_sha256_lanes();
+    if (lanes == 0 || lanes > widest) {
+        lanes = widest;
+    }
+    while (count > 0) {
+        size_t width = 1;
+        for (size_t w : {4, 8, 16}) {
+            if (w <= lanes) {
+                width = w;
+                if (count <= w) {
+                    break;
+                }
+            }
+        }
+        size_t take = std::min(count, width);
+        switch (width) {
+#ifdef SHA256_X86_LANES
+            case 16:
+                run_lanes<16>(jobs, take, iterations, iterate_x16);
+                break;
+            case 8:
+                run_lanes<8>(jobs, take, iterations, iterate_x8);
+                break;
+#endif
+#ifdef __GNUC__
+            case 4:
+                run_lanes<4>(jobs, take, iterations, iterate_x4);
+                break;
+#endif
+            default:
+                run_lanes<1>(jobs, take, iterations, iterate_x1);
+                break;
+        }
+        jobs += take;
+        count -= take;
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: pbkdf2_sha256_lanes                                  *
+    // * Description: Returns the widest lane count of this CPU, found once  *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+size_t pbkdf2_sha256_lanes() {
+    static const size_t widest = select_lanes();
+    return widest;
+}
+
+}
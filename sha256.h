@@ -0,0 +1,39 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace cop4530 {
+
+// SHA-256 (FIPS 180-4), HMAC-SHA256 (RFC 2104) and PBKDF2-HMAC-SHA256
+// (RFC 8018), self-contained so the project needs no crypto library.
+static const size_t sha256_bytes = 32;
+
+void sha256(const void* data, size_t n, unsigned char out[sha256_bytes]);
+void hmac_sha256(const void* key, size_t keyLength, const void* data, size_t n, unsigned char out[sha256_bytes]);
+void pbkdf2_sha256(std::string_view password, std::string_view salt, uint32_t iterations,
+                   unsigned char* out, size_t outLength);
+
+// One derivation of a batch: a 32 byte PBKDF2-HMAC-SHA256 key of password
+// and salt, written to out.
+struct Pbkdf2Job {
+    std::string_view password;
+    std::string_view salt;
+    unsigned char* out;
+};
+
+// Runs count derivations with the same iteration count. Nearly all of the
+// work is the iterations, each two SHA-256 compressions of one block, so the
+// jobs are run side by side in the lanes of a SIMD register: 16 with
+// AVX-512, 8 with AVX2 and 4 otherwise. lanes limits the width, 1 forcing
+// the scalar code; 0 takes the widest the CPU has, picked on first use.
+void pbkdf2_sha256_many(const Pbkdf2Job* jobs, size_t count, uint32_t iterations, size_t lanes = 0);
+
+// The widest lane count pbkdf2_sha256_many can use on this CPU.
+size_t pbkdf2_sha256_lanes();
+
+}
+
+#endif
@@ -0,0 +1,316 @@
+#include "snapshot.h"
+#include <cstring>
+#include <functional>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SNAPSHOT_X86_CRC 1
+#include <immintrin.h>
+#endif
+
+namespace cop4530 {
+
+namespace {
+
+const char snapshot_magic[8] = {'C', '4', '5', '3', '0', 'S', 'N', 'P'};
+const size_t writer_buffer = 1 << 20;
+
+typedef uint32_t (*crc_kernel)(uint32_t crc, const unsigned char* p, size_t n);
+
+struct CrcTable {
+    uint32_t entries[256];
+    CrcTable() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+            }
+            entries[i] = c;
+        }
+    }
+};
+
+uint32_t crc_scalar(uint32_t crc, const unsigned char* p, size_t n) {
+    static const CrcTable table;
+    for (size_t i = 0; i < n; ++i) {
+        crc = table.entries[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef SNAPSHOT_X86_CRC
+__attribute__((target("sse4.2")))
+uint32_t crc_sse42(uint32_t crc, const unsigned char* p, size_t n) {
+    size_t i = 0;
+#if defined(__x86_64__)
+    uint64_t c = crc;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, p + i, 8);
+        c = _mm_crc32_u64(c, word);
+    }
+    crc = static_cast<uint32_t>(c);
+#endif
+    for (; i < n; ++i) {
+        crc = _mm_crc32_u8(crc, p[i]);
+    }
+    return crc;
+}
+#endif
+
+crc_kernel select_crc() {
+#ifdef SNAPSHOT_X86_CRC
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        return crc_sse42;
+    }
+#endif
+    return crc_scalar;
+}
+
+}
+
+    // ***********************************************************************
+    // * Function Name: crc32c                                               *
+    // * Description: Extends a CRC-32C over n more bytes. The kernel is     *
+    // *              picked once, on first use                              *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - uint32_t crc: The CRC of the bytes before p, 0 to start           *
+    // * - const void* p: The bytes to add                                   *
+    // * - size_t n: The number of bytes                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+uint32_t crc32c(uint32_t crc, const void* p, size_t n) {
+    static const crc_kernel kernel = select_crc();
+    return ~kernel(~crc, static_cast<const unsigned char*>(p), n);
+}
+
+    // ***********************************************************************
+    // * Function Name: SnapshotWriter                                       *
+    // * Description: Constructor, buffers the snapshot header               *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::ostream& out: The binary stream to write to                  *
+    // * - uint32_t layout: snapshot_chained or snapshot_open_addressing     *
+    // * - uint64_t buckets: The bucket or slot count of the table           *
+    // * - uint64_t records: The number of records that will follow          *
+    // * - uint64_t fingerprint: The writing table's hasher fingerprint      *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+SnapshotWriter::SnapshotWriter(std::ostream& out, uint32_t layout, uint64_t buckets, uint64_t records,
+                               uint64_t fingerprint)
+    : out(out), crc(0) {
+    buffer.reserve(writer_buffer);
+    SnapshotHeader head;
+    std::memcpy(head.magic, snapshot_magic, sizeof(head.magic));
+    head.version = snapshot_version;
+    head.layout = layout;
+    head.buckets = buckets;
+    head.fingerprint = fingerprint;
+    head.records = records;
+    append(&head, sizeof(head));
+}
+
+    // ***********************************************************************
+    // * Function Name: block                                                *
+    // * Description: Writes raw bytes, such as the control bytes of an open *
+    // *              addressing table                                       *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const void* p: The bytes to write                                 *
+    // * - size_t n: The number of bytes                                     *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void SnapshotWriter::block(const void* p, size_t n) {
+    append(p, n);
+}
+
+    // ***********************************************************************
+    // * Function Name: record                                               *
+    // * Description: Writes one key value pair with its bucket or slot      *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - uint64_t position: The index the pair is stored at                *
+    // * - const std::string& key: The key                                   *
+    // * - const std::string& value: The value, as stored in the table       *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void SnapshotWriter::record(uint64_t position, const std::string& key, const std::string& value) {
+    SnapshotRecord rec;
+    rec.position = position;
+    rec.keyLength = static_cast<uint32_t>(key.size());
+    rec.valueLength = static_cast<uint32_t>(value.size());
+    append(&rec, sizeof(rec));
+    append(key.data(), key.size());
+    append(value.data(), value.size());
+}
+
+    // ***********************************************************************
+    // * Function Name: finish                                               *
+    // * Description: Writes the checksum and flushes the stream             *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool SnapshotWriter::finish() {
+    flush();
+    uint32_t sum = crc;
+    out.write(reinterpret_cast<const char*>(&sum), sizeof(sum));
+    out.flush();
+    return static_cast<bool>(out);
+}
+
+void SnapshotWriter::append(const void* p, size_t n) {
+    if (buffer.size() + n > writer_buffer) {
+        flush();
+    }
+    if (n > writer_buffer) {
+        crc = crc32c(crc, p, n);
+        out.write(static_cast<const char*>(p), n);
+        return;
+    }
+    buffer.append(static_cast<const char*>(p), n);
+}
+
+void SnapshotWriter::flush() {
+    crc = crc32c(crc, buffer.data(), buffer.size());
+    out.write(buffer.data(), buffer.size());
+    buffer.clear();
+}
+
+    // ***********************************************************************
+    // * Function Name: SnapshotReader                                       *
+    // * Description: Constructor, creates a reader with nothing open        *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+SnapshotReader::SnapshotReader() : head(), offset(0), end(0) {}
+
+    // ***********************************************************************
+    // * Function Name: open                                                 *
+    // * Description: Maps a snapshot and checks its magic, version and      *
+    // *              checksum. Fails without reading any record when one    *
+    // *              of them is wrong                                       *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - const char* filename: The snapshot to open                        *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool SnapshotReader::open(const char* filename) {
+    offset = end = 0;
+    if (!file.open(filename) || file.size() < sizeof(SnapshotHeader) + sizeof(uint32_t)) {
+        return false;
+    }
+    std::memcpy(&head, file.data(), sizeof(head));
+    if (std::memcmp(head.magic, snapshot_magic, sizeof(head.magic)) != 0 || head.version != snapshot_version) {
+        return false;
+    }
+    size_t body = file.size() - sizeof(uint32_t);
+    uint32_t stored;
+    std::memcpy(&stored, file.data() + body, sizeof(stored));
+    if (crc32c(0, file.data(), body) != stored) {
+        return false;
+    }
+    offset = sizeof(head);
+    end = body;
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: header                                               *
+    // * Description: Returns the header of the open snapshot                *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+const SnapshotHeader& SnapshotReader::header() const {
+    return head;
+}
+
+    // ***********************************************************************
+    // * Function Name: same_hash                                            *
+    // * Description: Returns whether the snapshot was written by a table    *
+    // *              whose hasher matches the reading table's               *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - uint64_t fingerprint: The reading table's hasher fingerprint      *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool SnapshotReader::same_hash(uint64_t fingerprint) const {
+    return head.fingerprint == fingerprint;
+}
+
+    // ***********************************************************************
+    // * Function Name: block                                                *
+    // * Description: Returns the next n raw bytes, or nullptr when fewer    *
+    // *              than n remain                                          *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t n: The number of bytes to take                             *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+const char* SnapshotReader::block(size_t n) {
+    if (end - offset < n) {
+        return nullptr;
+    }
+    const char* p = file.data() + offset;
+    offset += n;
+    return p;
+}
+
+    // ***********************************************************************
+    // * Function Name: next                                                 *
+    // * Description: Reads the next record. Returns false at the end of the *
+    // *              records or when a record runs past the end of the file *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - uint64_t& position: Set to the saved bucket or slot index         *
+    // * - std::string_view& key: Set to the key bytes                       *
+    // * - std::string_view& value: Set to the value bytes                   *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool SnapshotReader::next(uint64_t& position, std::string_view& key, std::string_view& value) {
+    if (end - offset < sizeof(SnapshotRecord)) {
+        return false;
+    }
+    SnapshotRecord rec;
+    std::memcpy(&rec, file.data() + offset, sizeof(rec));
+    size_t length = static_cast<size_t>(rec.keyLength) + rec.valueLength;
+    if (end - offset - sizeof(rec) < length) {
+        return false;
+    }
+    const char* p = file.data() + offset + sizeof(rec);
+    position = rec.position;
+    key = std::string_view(p, rec.keyLength);
+    value = std::string_view(p + rec.keyLength, rec.valueLength);
+    offset += sizeof(rec) + length;
+    return true;
+}
+
+}
@@ -0,0 +1,91 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include "mappedfile.h"
+
+namespace cop4530 {
+
+// Binary snapshot of a HashTable<std::string, std::string>. Integers are
+// stored in host byte order; a snapshot from a machine of the other
+// endianness fails the magic check.
+//
+//   header    magic "C4530SNP", version, layout, bucket count,
+//             hash fingerprint, record count
+//   control   open addressing only: one control byte per slot
+//   records   bucket or slot index, key length, value length, key bytes,
+//             value bytes (values are stored encoded, as held in the table)
+//   checksum  CRC-32C of everything before it
+//
+// A snapshot taken with the same layout, bucket count and hash function is
+// restored by placing every record at its saved index, without hashing,
+// probing or encoding. Otherwise the records are re-hashed into the table.
+static const uint32_t snapshot_version = 1;
+static const uint32_t snapshot_chained = 0;
+static const uint32_t snapshot_open_addressing = 1;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t layout;
+    uint64_t buckets;
+    uint64_t fingerprint;
+    uint64_t records;
+};
+
+struct SnapshotRecord {
+    uint64_t position;
+    uint32_t keyLength;
+    uint32_t valueLength;
+};
+
+// A table fingerprints its hasher by hashing this string. A snapshot only
+// keeps its bucket indexes valid for a table whose fingerprint matches the
+// one in its header; std::hash in particular may differ between builds.
+static const char fingerprint_probe[] = "cop4530 snapshot fingerprint";
+
+// CRC-32C of n bytes continuing from crc; uses the SSE4.2 instruction when
+// the CPU has it.
+uint32_t crc32c(uint32_t crc, const void* p, size_t n);
+
+// Streams a snapshot to out through a 1 MB buffer, checksumming as it goes.
+class SnapshotWriter {
+public:
+    SnapshotWriter(std::ostream& out, uint32_t layout, uint64_t buckets, uint64_t records, uint64_t fingerprint);
+    void block(const void* p, size_t n);
+    void record(uint64_t position, const std::string& key, const std::string& value);
+    bool finish();
+
+private:
+    std::ostream& out;
+    std::string buffer;
+    uint32_t crc;
+    void append(const void* p, size_t n);
+    void flush();
+};
+
+// Maps a snapshot and validates its header, size and checksum before any
+// record is read. The views returned by next() point into the mapping.
+class SnapshotReader {
+public:
+    SnapshotReader();
+    bool open(const char* filename);
+    const SnapshotHeader& header() const;
+    bool same_hash(uint64_t fingerprint) const;
+    const char* block(size_t n);
+    bool next(uint64_t& position, std::string_view& key, std::string_view& value);
+
+private:
+    MappedFile file;
+    SnapshotHeader head;
+    size_t offset;
+    size_t end;
+};
+
+}
+
+#endif
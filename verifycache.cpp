@@ -0,0 +1,214 @@
+#include "verifycache.h"
+#include "fasthash.h"
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+namespace cop4530 {
+
+    // ***********************************************************************
+    // * Function Name: VerifyCache                                          *
+    // * Description: Constructor, splits capacity entries over the shards   *
+    // *              and draws the seeds the digests are keyed with         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - size_t capacity: The most logins to remember, at least 1          *
+    // * - size_t shards: The number of independently locked parts           *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+VerifyCache::VerifyCache(size_t capacity, size_t shards) : capacity(std::max<size_t>(capacity, 1)) {
+    shards = std::max<size_t>(1, std::min(shards, this->capacity));
+    for (size_t i = 0; i < shards; ++i) {
+        this->shards.emplace_back(new Shard);
+        size_t slots = this->capacity / shards + (i < this->capacity % shards);
+        this->shards.back()->slots.resize(slots);
+        this->shards.back()->index.reserve(slots);
+    }
+    std::random_device device;
+    for (auto& seed : seeds) {
+        seed = static_cast<uint64_t>(device()) << 32 | device();
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: lookup                                               *
+    // * Description: Returns true if password is the last one remembered    *
+    // *              for user, and marks the entry as recently used         *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::string_view user: The username                               *
+    // * - std::string_view password: The plaintext password                 *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+bool VerifyCache::lookup(std::string_view user, std::string_view password) {
+    uint64_t digest[2];
+    digestOf(password, digest);
+    Shard& shard = shardOf(user);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    auto it = shard.index.find(user);
+    if (it == shard.index.end() || std::memcmp(shard.slots[it->second].digest, digest, sizeof(digest)) != 0) {
+        ++shard.misses;
+        return false;
+    }
+    shard.slots[it->second].referenced = true;
+    ++shard.hits;
+    return true;
+}
+
+    // ***********************************************************************
+    // * Function Name: insert                                               *
+    // * Description: Remembers that password verified for user, replacing   *
+    // *              the user's entry or evicting one by CLOCK              *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::string_view user: The username                               *
+    // * - std::string_view password: The password that matched              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void VerifyCache::insert(std::string_view user, std::string_view password) {
+    uint64_t digest[2];
+    digestOf(password, digest);
+    Shard& shard = shardOf(user);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    auto it = shard.index.find(user);
+    if (it != shard.index.end()) {
+        std::memcpy(shard.slots[it->second].digest, digest, sizeof(digest));
+        return;
+    }
+    // new entries start unreferenced, so a user seen once goes before any seen twice
+    for (;;) {
+        Slot& slot = shard.slots[shard.hand];
+        if (!slot.used || !slot.referenced) {
+            break;
+        }
+        slot.referenced = false;
+        shard.hand = (shard.hand + 1) % shard.slots.size();
+    }
+    size_t victim = shard.hand;
+    shard.hand = (shard.hand + 1) % shard.slots.size();
+    Slot& slot = shard.slots[victim];
+    if (slot.used) {
+        shard.index.erase(slot.user);
+        ++shard.evictions;
+    }
+    slot.user.assign(user.data(), user.size());
+    std::memcpy(slot.digest, digest, sizeof(digest));
+    slot.used = true;
+    slot.referenced = false;
+    shard.index.emplace(slot.user, victim);
+    ++shard.insertions;
+}
+
+    // ***********************************************************************
+    // * Function Name: erase                                                *
+    // * Description: Forgets user, whose password has changed or who has    *
+    // *              been removed                                           *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::string_view user: The username                               *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void VerifyCache::erase(std::string_view user) {
+    Shard& shard = shardOf(user);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    auto it = shard.index.find(user);
+    if (it == shard.index.end()) {
+        return;
+    }
+    Slot& slot = shard.slots[it->second];
+    shard.index.erase(it);
+    slot.used = false;
+    slot.referenced = false;
+    slot.user.clear();
+    ++shard.invalidations;
+}
+
+    // ***********************************************************************
+    // * Function Name: clear                                                *
+    // * Description: Forgets every user. The counters are kept              *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void VerifyCache::clear() {
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        shard->index.clear();
+        for (auto& slot : shard->slots) {
+            slot.used = false;
+            slot.referenced = false;
+            slot.user.clear();
+        }
+        shard->hand = 0;
+    }
+}
+
+    // ***********************************************************************
+    // * Function Name: stats                                                *
+    // * Description: Sums the counters of every shard                       *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - None                                                              *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+CacheStats VerifyCache::stats() const {
+    CacheStats stats;
+    stats.capacity = capacity;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        stats.entries += shard->index.size();
+        stats.hits += shard->hits;
+        stats.misses += shard->misses;
+        stats.insertions += shard->insertions;
+        stats.evictions += shard->evictions;
+        stats.invalidations += shard->invalidations;
+    }
+    size_t lookups = stats.hits + stats.misses;
+    stats.hit_rate = lookups ? static_cast<double>(stats.hits) / lookups : 0;
+    return stats;
+}
+
+    // ***********************************************************************
+    // * Function Name: shardOf                                              *
+    // * Description: Returns the shard that holds user                      *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::string_view user: The username                               *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+VerifyCache::Shard& VerifyCache::shardOf(std::string_view user) const {
+    return *shards[hash_bytes(user.data(), user.size()) % shards.size()];
+}
+
+    // ***********************************************************************
+    // * Function Name: digestOf                                             *
+    // * Description: Hashes the password under each secret seed             *
+    // *                                                                     *
+    // * Parameter Description:                                              *
+    // * - std::string_view password: The plaintext password                 *
+    // * - uint64_t digest[]: Receives the two 64 bit halves                 *
+    // * Date: 7/17/2024                                                     *
+    // * Author: Dallas Toth                                                 *
+    // * References: None                                                    *
+    // ***********************************************************************
+void VerifyCache::digestOf(std::string_view password, uint64_t digest[2]) const {
+    digest[0] = hash_bytes(password.data(), password.size(), seeds[0]);
+    digest[1] = hash_bytes(password.data(), password.size(), seeds[1]);
+}
+
+}
@@ -0,0 +1,84 @@
+#ifndef VERIFYCACHE_H
+#define VERIFYCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace cop4530 {
+
+// What VerifyCache::stats() reports. hits and misses count lookups;
+// invalidations count erase() calls that found their user.
+struct CacheStats {
+    size_t capacity = 0;
+    size_t entries = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t insertions = 0;
+    size_t evictions = 0;
+    size_t invalidations = 0;
+    double hit_rate = 0; // hits / (hits + misses)
+};
+
+// Fixed-size cache of recent successful logins: which password last
+// verified for each user. It never holds a password, only a 128 bit digest
+// of it keyed by secret seeds drawn when the cache is made. The digest is a
+// fast hash rather than SHA-256: it only has to tell passwords apart for
+// someone who cannot see the seeds, and whoever can read the cache can read
+// the seeds too, so a slower hash would protect nothing and cost more than
+// the lookup it saves.
+//
+// Users are split across shards, each behind its own mutex, so threads
+// contend only when their users share a shard. A full shard evicts with
+// CLOCK: a hit sets the entry's reference bit, and the hand passing over
+// the slots clears set bits and evicts the first entry found clear, which
+// keeps frequently used entries at the cost of one bit each.
+//
+// The cache only knows what it is told: whoever changes or removes a
+// user's password must erase() the user, or clear() for a wholesale
+// change, before the old password can be presented again.
+class VerifyCache {
+public:
+    explicit VerifyCache(size_t capacity, size_t shards = 16);
+    VerifyCache(const VerifyCache&) = delete;
+    VerifyCache& operator=(const VerifyCache&) = delete;
+
+    bool lookup(std::string_view user, std::string_view password);
+    void insert(std::string_view user, std::string_view password);
+    void erase(std::string_view user);
+    void clear();
+    CacheStats stats() const;
+
+private:
+    struct Slot {
+        std::string user;
+        uint64_t digest[2];
+        bool used = false;
+        bool referenced = false;
+    };
+    struct alignas(64) Shard {
+        mutable std::mutex lock;
+        std::vector<Slot> slots;
+        std::unordered_map<std::string_view, size_t> index; // views into slots[i].user
+        size_t hand = 0;
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t insertions = 0;
+        size_t evictions = 0;
+        size_t invalidations = 0;
+    };
+    std::vector<std::unique_ptr<Shard>> shards;
+    size_t capacity;
+    uint64_t seeds[2];
+    Shard& shardOf(std::string_view user) const;
+    void digestOf(std::string_view password, uint64_t digest[2]) const;
+};
+
+}
+
+#endif